@@ -2,6 +2,9 @@
 
 #include "Selector.h"
 #include "Helpers.h"
+#include "Regex.h"
+
+#include <memory>
 
 class AttributeSelector : public Selector
 {
@@ -19,15 +22,25 @@ public:
     };
 
     AttributeSelector() = delete;
-    AttributeSelector(Operator _operator, std::string_view key, std::string_view value, bool sensitive) : key_(toLower(key)), value_(sensitive ? toLower(value) : value), operator_(_operator), icase_(sensitive) {}
+    AttributeSelector(Operator _operator, std::string_view key, std::string_view value, bool sensitive) : key_(toLower(key)), value_(sensitive ? toLower(value) : value), operator_(_operator), icase_(sensitive), atom_(NameAtom::Intern(key_)),
+          regex_(_operator == Operator::Regex ? std::make_shared<const Regex>(value_) : nullptr) {}
     bool matches(xmlNodePtr node) const override;
+    void collectSubjectKeys(std::vector<std::uint32_t> &keys) const override;
     ~AttributeSelector() = default;
 
     std::string toString() const override;
 
+    Operator getOperator() const { return operator_; }
+    const std::string &getKey() const { return key_; }
+    const std::string &getValue() const { return value_; }
+    bool isCaseInsensitive() const { return icase_; }
+    const NameAtom *getAtom() const { return atom_; }
+
 private:
     std::string key_;
     std::string value_;
     Operator operator_;
     bool icase_;
+    const NameAtom *atom_;
+    std::shared_ptr<const Regex> regex_;
 };
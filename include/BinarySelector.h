@@ -16,16 +16,34 @@ public:
 
 public:
     BinarySelector() = delete;
-    BinarySelector(Operator _operator, SelectorPtr lselector, SelectorPtr rselector) : lselector_(lselector), rselector_(rselector), operator_(_operator), adjacent_(false) {}
-    BinarySelector(SelectorPtr lselector, SelectorPtr rselector, bool adjacent) : lselector_(lselector), rselector_(rselector), operator_(Operator::Adjacent), adjacent_(adjacent) {}
+    BinarySelector(Operator _operator, SelectorPtr lselector, SelectorPtr rselector) : lselector_(lselector), rselector_(rselector), operator_(_operator), adjacent_(false) { initAncestorFilter(); }
+    BinarySelector(SelectorPtr lselector, SelectorPtr rselector, bool adjacent) : lselector_(lselector), rselector_(rselector), operator_(Operator::Adjacent), adjacent_(adjacent) { initAncestorFilter(); }
     ~BinarySelector() = default;
     bool matches(xmlNodePtr node) const override;
+    bool matches(xmlNodePtr node, const MatchContext &context) const override;
+
+    void collectSubjectKeys(std::vector<std::uint32_t> &keys) const override;
+    void collectAncestorKeys(std::vector<std::uint32_t> &keys) const override;
+    bool usesAncestorFilter() const override { return usesAncestorFilter_; }
 
     std::string toString() const override;
 
+    Operator getOperator() const { return operator_; }
+    const SelectorPtr &getLeft() const { return lselector_; }
+    const SelectorPtr &getRight() const { return rselector_; }
+    bool isAdjacent() const { return adjacent_; }
+
+private:
+    void initAncestorFilter();
+    bool matchesWith(xmlNodePtr node, const MatchContext *context) const;
+    bool hasMatchingAncestor(xmlNodePtr node, const MatchContext &context) const;
+
 private:
     SelectorPtr lselector_;
     SelectorPtr rselector_;
     Operator operator_;
     bool adjacent_;
+
+    std::vector<std::uint32_t> filterKeys_;
+    bool usesAncestorFilter_;
 };
\ No newline at end of file
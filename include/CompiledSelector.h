@@ -0,0 +1,142 @@
+#pragma once
+
+#include "Selector.h"
+#include "NameAtom.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Flattens a selector tree into a right-to-left instruction stream that is
+// executed by a small backtracking interpreter instead of virtual matches()
+// calls. Semantics are identical to evaluating the source tree directly.
+//
+// An adaptive selector also learns which tests of each compound selector
+// reject most often: the tests of a compound are run as a group that counts
+// how often each one is tried and passes, and every AdaptInterval runs the
+// group is reordered so the tests most likely to reject, per unit of cost,
+// come first. The counts can be exported and imported again, so a warmed
+// ordering survives a restart.
+class CompiledSelector : public Selector
+{
+public:
+    enum class Opcode : std::uint8_t
+    {
+        Tag,          // element name is the atom names_[arg]
+        Attribute,    // AttributeSelector operand
+        Pseudo,       // TagSelector operand (structural and state pseudo-classes)
+        Text,         // TextSelector operand
+        Call,         // any other Selector, through its virtual matches()
+        Sub,          // programs_[arg] matches at the current node
+        Not,          // programs_[arg] does not match at the current node
+        Has,          // programs_[arg] matches a descendant element
+        HasChild,     // programs_[arg] matches a child element
+        Group,        // every test of groups_[arg] passes, run in its current order
+        IsElement,    // current node is an element
+        Filter,       // ancestor filter may hold every key of keys_[arg]
+        Parent,       // move to the parent element
+        Ancestor,     // move to each ancestor in turn (backtracks)
+        PrevSibling,  // move to the previous element sibling
+        PrevSiblings, // move to each previous element sibling in turn (backtracks)
+        Fork,         // also try the code at arg from the current node
+        Match,        // success
+    };
+
+    struct Instruction
+    {
+        Opcode op;
+        std::uint32_t arg;
+    };
+
+    using Program = std::vector<Instruction>;
+
+    // Counts for one test of a group.
+    struct PredicateStats
+    {
+        std::string predicate;
+        std::uint64_t tested = 0;
+        std::uint64_t passed = 0;
+    };
+
+    static constexpr std::uint64_t AdaptInterval = 1024;
+    // Tests beyond this many in one compound run in source order.
+    static constexpr std::size_t MaxGroupSize = 16;
+
+    CompiledSelector() = delete;
+    explicit CompiledSelector(SelectorPtr source, bool adaptive = false);
+    ~CompiledSelector() = default;
+
+    bool matches(xmlNodePtr node) const override;
+    bool matches(xmlNodePtr node, const MatchContext &context) const override;
+    std::string toString() const override { return source_->toString(); }
+
+    void collectSubjectKeys(std::vector<std::uint32_t> &keys) const override { source_->collectSubjectKeys(keys); }
+    void collectAncestorKeys(std::vector<std::uint32_t> &keys) const override { source_->collectAncestorKeys(keys); }
+    bool usesAncestorFilter() const override { return source_->usesAncestorFilter(); }
+
+    const SelectorPtr &getSource() const { return source_; }
+    const std::vector<Program> &getPrograms() const { return programs_; }
+    std::string disassemble() const;
+
+    bool isAdaptive() const { return adaptive_; }
+    // Counts of every group, each in compile order.
+    std::vector<std::vector<PredicateStats>> getStats() const;
+    // Reorders every group from its counts now instead of at the next interval.
+    void adapt() const;
+    // Counts as text, for importStats on a selector with the same source.
+    std::string exportStats() const;
+    // Replaces the counts with exported ones and reorders. Returns false, and
+    // changes nothing, when stats do not come from a selector compiled from
+    // the same source.
+    bool importStats(std::string_view stats);
+
+private:
+    struct Counter
+    {
+        mutable std::atomic<std::uint64_t> tested{0};
+        mutable std::atomic<std::uint64_t> passed{0};
+    };
+
+    struct Group
+    {
+        Program tests;
+        std::vector<std::string> labels;
+        std::deque<Counter> counters;
+        // Position i runs tests[(order >> 4 * i) & 15]; a single word so
+        // concurrent readers always see a whole permutation.
+        mutable std::atomic<std::uint64_t> order{0};
+        mutable std::atomic<std::uint64_t> runs{0};
+    };
+
+
+    std::uint32_t compileProgram(const SelectorPtr &selector, bool atCandidate);
+    void compileChain(std::uint32_t program, const SelectorPtr &selector, bool atCandidate);
+    void compileCompound(std::uint32_t program, const SelectorPtr &selector, bool atCandidate);
+    void compileTest(std::uint32_t program, const SelectorPtr &selector, bool atCandidate);
+    void emit(std::uint32_t program, Opcode op, std::uint32_t arg = 0);
+    void emitTest(std::uint32_t program, Opcode op, const Selector *source, std::uint32_t arg);
+    std::uint32_t addOperand(const Selector *selector);
+
+    bool run(std::uint32_t program, xmlNodePtr node, const MatchContext *context) const;
+    bool test(const Instruction &ins, xmlNodePtr node, const MatchContext *context) const;
+    bool runGroup(const Group &group, xmlNodePtr node, const MatchContext *context) const;
+    void reorder(const Group &group) const;
+    // Nodes of the subtree at scope matched by programs_[program], in document order.
+    void collect(std::uint32_t program, xmlNodePtr scope, NodeSet &found) const;
+
+private:
+    SelectorPtr source_;
+    std::vector<Program> programs_;
+    std::vector<const Selector *> operands_;
+    std::vector<const NameAtom *> names_;
+    std::vector<std::vector<std::uint32_t>> keys_;
+
+    bool adaptive_;
+    // Deque so the atomics stay in place.
+    std::deque<Group> groups_;
+    // Labels of the tests emitted by the compound being compiled, if grouped.
+    std::vector<std::string> *labels_ = nullptr;
+};
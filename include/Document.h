@@ -3,8 +3,13 @@
 #include <libxml/tree.h>
 #include <libxml/HTMLparser.h>
 
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "DocumentIndex.h"
+#include "MatchCursor.h"
+#include "ParallelMatcher.h"
 #include "QueryResult.h"
 
 class Document
@@ -22,12 +27,45 @@ public:
 
 	QueryResult Find(std::string_view) const;
 	QueryResult Find(const SelectorPtr &) const;
+	QueryResult Find(std::string_view, std::size_t limit) const;
+	QueryResult Find(const SelectorPtr &, std::size_t limit) const;
+	// Scans documents of at least options.threshold elements with several
+	// threads when no index applies.
+	QueryResult Find(std::string_view, const ParallelOptions &options) const;
+	QueryResult Find(const SelectorPtr &, const ParallelOptions &options) const;
+	// One result per selector, all found in a single walk over the document.
+	std::vector<QueryResult> FindMany(const std::vector<std::string> &) const;
+	std::vector<QueryResult> FindMany(const std::vector<SelectorPtr> &) const;
+	std::optional<Node> FindFirst(std::string_view) const;
+	std::optional<Node> FindFirst(const SelectorPtr &) const;
+	bool Exists(std::string_view) const;
+	bool Exists(const SelectorPtr &) const;
+	std::size_t Count(std::string_view) const;
+	std::size_t Count(const SelectorPtr &) const;
+	void ForEach(std::string_view, const std::function<bool(Node)> &visit) const;
+	void ForEach(const SelectorPtr &, const std::function<bool(Node)> &visit) const;
+	MatchRange Stream(std::string_view) const;
+	MatchRange Stream(const SelectorPtr &) const;
+	// How Find evaluates a selector over the document (see DocumentIndex::Plan).
+	QueryPlan Explain(std::string_view) const;
+	QueryPlan Explain(const SelectorPtr &) const;
+
+	// Rebuilds the index from the current tree. Queries go through the index
+	// as it was last built, so after changing the tree through libxml2 call
+	// this before querying again: until then, inserted elements may be missed
+	// and removed ones reached after they were freed.
+	void Reindex();
 
 	xmlNodePtr getRoot() { return root_; }
+	const DocumentIndex *getIndex() const { return index_.get(); }
 
 	bool isValid() const { return htmldoc_ && root_ != nullptr; }
 
+protected:
+	bool attach();
+
 protected:
 	std::unique_ptr<xmlDoc, decltype(&xmlFreeDoc)> htmldoc_;
 	xmlNodePtr root_;
+	std::unique_ptr<DocumentIndex> index_;
 };
\ No newline at end of file
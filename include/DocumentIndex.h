@@ -0,0 +1,106 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ElementInfo.h"
+#include "NameAtom.h"
+#include "QueryPlan.h"
+#include "Selector.h"
+
+// Lookup structures over a parsed document. Once built, an index is found
+// from any node of its document through a registry keyed by the xmlDoc, until
+// it is destroyed; no _private slot is touched.
+//
+// Indexes describe the tree as it was when they were built: posting lists and
+// infos hold the nodes seen then, and nothing tracks later changes. Once the
+// tree is changed, the index must be replaced (Document::Reindex) before it
+// is used again.
+class DocumentIndex
+{
+public:
+	using ElementList = std::vector<xmlNodePtr>;
+
+	// Index keys every node matching a selector must carry, taken from its
+	// rightmost compound selector. Pointers refer into the selector.
+	struct SubjectKeys
+	{
+		const std::string *id = nullptr;
+		const std::string *tag = nullptr;
+		std::vector<const std::string *> classes;
+	};
+
+	DocumentIndex() = delete;
+	explicit DocumentIndex(xmlDocPtr doc) : doc_(doc) {}
+	DocumentIndex(const DocumentIndex &) = delete;
+	DocumentIndex &operator=(const DocumentIndex &) = delete;
+	~DocumentIndex();
+
+	// Built index of node's document, or nullptr.
+	static const DocumentIndex *FromNode(xmlNodePtr node);
+
+	static SubjectKeys GetSubjectKeys(const Selector &selector);
+
+	// Builds every index in a single pass over the document and registers
+	// the result; later lookups build on demand if this was never called.
+	void Build() const;
+
+	// Info held for element, or nullptr when it is not an element of this
+	// index.
+	const ElementInfo *GetElementInfo(xmlNodePtr element) const;
+
+	// Elements with the given id, lowercased tag name or class token, in
+	// document order.
+	const ElementList &GetElementsById(const std::string &id) const;
+	const ElementList &GetElementsByTagName(const std::string &name) const;
+	const ElementList &GetElementsByClassName(const std::string &name) const;
+
+	// Every element, in document order.
+	const ElementList &GetElements() const;
+	std::size_t ElementCount() const;
+	// Elements in the subtree rooted at node; the whole document for a node
+	// that is not an indexed element.
+	std::size_t SubtreeSize(xmlNodePtr node) const;
+
+	// Cheapest way to evaluate selector over the subtree rooted at scope,
+	// chosen from the sizes of the posting lists and subtrees involved.
+	QueryPlan Plan(xmlNodePtr scope, const Selector &selector) const;
+
+	// Evaluates selector over the subtree rooted at scope as Plan chooses,
+	// keeping the first limit matches. Returns false when the plan is a scan,
+	// which the caller should run instead.
+	bool Find(xmlNodePtr scope, const Selector &selector, NodeSet &result, std::size_t limit = SIZE_MAX) const;
+
+private:
+	void build() const;
+	// Scratch state of one build.
+	struct BuildState;
+
+	void stampChildren(xmlNodePtr parent, BuildState &state) const;
+	ElementInfo *infoOf(xmlNodePtr element) const;
+	void insertInfo(xmlNodePtr element, ElementInfo *info) const;
+	// Smallest posting list holding every element compound may match.
+	const ElementList &candidates(const Selector &compound) const;
+	void execute(const QueryPlan &plan, xmlNodePtr scope, const Selector &selector, NodeSet &result, std::size_t limit) const;
+	const ElementList &lookup(const std::unordered_map<std::string, ElementList> &map, const std::string &key) const;
+
+private:
+	xmlDocPtr doc_;
+
+	mutable std::once_flag buildOnce_;
+	// Deque so the pointers in infos_ stay valid while it grows.
+	mutable std::deque<ElementInfo> elements_;
+	// Element to info, open addressed on the element's address and kept at
+	// most half full.
+	mutable std::vector<std::pair<xmlNodePtr, ElementInfo *>> infos_;
+	mutable ElementList ordered_;
+	mutable std::unordered_map<std::string, ElementList> ids_;
+	mutable std::unordered_map<std::string, ElementList> tags_;
+	mutable std::unordered_map<std::string, ElementList> classes_;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <cstdint>
+#include <utility>
+
+class NameAtom;
+
+// Facts about an element of an indexed document, computed once by
+// DocumentIndex and kept in a table of its own; the nodes' _private slots are
+// left to the application.
+struct ElementInfo
+{
+	// Atom of the element's name, or nullptr when nothing interned it.
+	const NameAtom *name = nullptr;
+
+	// 1-based position among the parent's element children, and their count.
+	std::uint32_t position = 0;
+	std::uint32_t siblings = 0;
+
+	// Same, counting only siblings with the same name; 0 for an unnamed
+	// element.
+	std::uint32_t typePosition = 0;
+	std::uint32_t typeSiblings = 0;
+
+	// 0-based position among the document's elements in document order. The
+	// subtree rooted here is the interval [order, order + subtreeSize).
+	std::uint32_t order = 0;
+	// Elements in the subtree rooted here, this one included.
+	std::uint32_t subtreeSize = 0;
+
+	// Whether node is this element or one of its descendants.
+	bool contains(const ElementInfo &node) const { return node.order - order < subtreeSize; }
+
+	// Info the index of node's document holds for it, or nullptr.
+	static const ElementInfo *Of(xmlNodePtr node);
+	// Infos of two elements of one document, both from the index it has now,
+	// or two nullptrs unless it holds both. Orders and intervals are only
+	// comparable between infos of the same index.
+	static std::pair<const ElementInfo *, const ElementInfo *> Of(xmlNodePtr a, xmlNodePtr b);
+
+	// Whether ancestor is node or one of its ancestors; constant time when
+	// both are elements of the same indexed document.
+	static bool IsInclusiveAncestor(xmlNodePtr ancestor, xmlNodePtr node)
+	{
+		if (ancestor != nullptr && node != nullptr)
+		{
+			auto [a, n] = Of(ancestor, node);
+			if (a != nullptr)
+			{
+				return a->contains(*n);
+			}
+		}
+		for (; node != nullptr; node = node->parent)
+		{
+			if (node == ancestor)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+};
@@ -10,6 +10,8 @@
 #include <libxml/HTMLparser.h>
 #include <sstream>
 
+#include "NameAtom.h"
+
 static inline std::string toLower(std::string_view s)
 {
     std::string result(s);
@@ -150,6 +152,10 @@ static inline bool NodeIsEmpty(xmlNodePtr node)
 
 static inline std::string getLowerElementName(xmlNodePtr node)
 {
+    if (const NameAtom *atom = NameAtom::Of(node))
+    {
+        return atom->str();
+    }
     std::string nodeName(reinterpret_cast<const char *>(node->name));
     std::transform(nodeName.begin(), nodeName.end(), nodeName.begin(), ::tolower);
     return nodeName;
@@ -161,14 +167,33 @@ static inline bool IsEqualElement(xmlNodePtr node1, xmlNodePtr node2)
     {
         return false;
     }
-    if (node1->name == nullptr || node2->name == nullptr)
+    return NameAtom::SameName(node1, node2);
+}
+
+static inline bool IsEqualElement(xmlNodePtr node1, std::string_view name)
+{
+    if (!node1)
+    {
+        return false;
+    }
+    if (node1->name == nullptr)
     {
         return false;
     }
-    return getLowerElementName(node1) == getLowerElementName(node2);
+
+    const char *cur = reinterpret_cast<const char *>(node1->name);
+    for (char c : name)
+    {
+        if (*cur == '\0' || static_cast<char>(std::tolower(static_cast<unsigned char>(*cur))) != c)
+        {
+            return false;
+        }
+        cur++;
+    }
+    return *cur == '\0';
 }
 
-static inline bool IsEqualElement(xmlNodePtr node1, std::string_view name)
+static inline bool IsEqualElement(xmlNodePtr node1, const NameAtom *name)
 {
     if (!node1)
     {
@@ -178,7 +203,7 @@ static inline bool IsEqualElement(xmlNodePtr node1, std::string_view name)
     {
         return false;
     }
-    return toLower(normalizeHtmlText(reinterpret_cast<const char *>(node1->name))) == name;
+    return name->Matches(node1);
 }
 
 static inline bool NodeIsOnlyChild(xmlNodePtr node, bool ofType)
@@ -188,6 +213,12 @@ static inline bool NodeIsOnlyChild(xmlNodePtr node, bool ofType)
         return false;
     }
 
+    const ElementInfo *info = ElementInfo::Of(node);
+    if (info != nullptr && (!ofType || info->typePosition != 0))
+    {
+        return (ofType ? info->typeSiblings : info->siblings) == 1;
+    }
+
     xmlNodePtr parent = node->parent;
     if (parent == nullptr)
     {
@@ -222,6 +253,13 @@ static inline std::pair<int, int> NodeSiblingsCount(xmlNodePtr node, bool ofType
         return std::make_pair(0, 0);
     }
 
+    const ElementInfo *info = ElementInfo::Of(node);
+    if (info != nullptr && (!ofType || info->typePosition != 0))
+    {
+        return ofType ? std::make_pair(static_cast<int>(info->typeSiblings), static_cast<int>(info->typePosition))
+                      : std::make_pair(static_cast<int>(info->siblings), static_cast<int>(info->position));
+    }
+
     xmlNodePtr parent = node->parent;
 
     if (parent == nullptr)
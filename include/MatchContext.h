@@ -0,0 +1,180 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "NodeSet.h"
+
+// Counting Bloom filter over the tag, id and class keys of the elements on
+// the current ancestor chain. A negative answer is exact, a positive one may
+// be a false positive.
+class AncestorFilter
+{
+public:
+	AncestorFilter() { counters_.fill(0); }
+
+	void push(xmlNodePtr element);
+	void pop();
+	void clear();
+
+	bool mayContain(std::uint32_t key) const
+	{
+		return counters_[key & kMask] != 0 && counters_[(key >> kBits) & kMask] != 0;
+	}
+
+	bool mayContainAll(const std::vector<std::uint32_t> &keys) const
+	{
+		for (std::uint32_t key : keys)
+		{
+			if (!mayContain(key))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static std::uint32_t TagKey(std::string_view name);
+	static std::uint32_t IdKey(std::string_view id);
+	static std::uint32_t ClassKey(std::string_view name);
+
+	static void CollectKeys(xmlNodePtr element, std::vector<std::uint32_t> &keys);
+
+private:
+	static constexpr unsigned kBits = 12;
+	static constexpr std::uint32_t kMask = (1u << kBits) - 1;
+
+	void add(std::uint32_t key);
+	void remove(std::uint32_t key);
+
+	std::array<std::uint8_t, 1u << kBits> counters_;
+	std::vector<std::uint32_t> keys_;
+	std::vector<std::size_t> frames_;
+};
+
+// State elements inherit from their ancestors, kept for the ancestor chain of
+// the node a SubtreeWalk is at: the values of the lang attributes along it.
+class InheritedState
+{
+public:
+	bool active() const { return active_; }
+	// Starts tracking with the ancestors of node; the walk keeps the state in
+	// step from then on.
+	void start(xmlNodePtr node);
+	void push(xmlNodePtr element);
+	void pop();
+
+	// Lang values of the ancestors carrying one, outermost first.
+	const std::vector<std::string> &langs() const { return langs_; }
+
+private:
+	bool active_ = false;
+	std::vector<std::string> langs_;
+	std::vector<std::size_t> frames_;
+};
+
+// Results of selectors on elements, kept by one traversal. Nested
+// combinators test the same sub-selector on the same ancestors and siblings
+// once per candidate below or after them; with the results kept, a query does
+// at most one test per selector node and element. Results are exact, whatever
+// context produced them, but only valid while the tree is unchanged.
+//
+// Each SubtreeWalk owns its table, so a walk paused between calls, as a
+// MatchCursor's is, may be resumed on another thread; it must not be used by
+// two threads at once. The slots are allocated on the first insert.
+class MatchMemo
+{
+public:
+	// Forgets every result by advancing an epoch instead of clearing the
+	// slots, unless the table grew past kRetainedSlots, in which case it
+	// releases them.
+	void reset();
+
+	static constexpr std::size_t kRetainedSlots = 1 << 14;
+
+	// Stored result of selector key on node: 1 or 0, or -1 when unknown.
+	int find(const void *key, xmlNodePtr node) const;
+	void insert(const void *key, xmlNodePtr node, bool result);
+
+	std::size_t size() const { return used_; }
+	std::size_t capacity() const { return slots_.size(); }
+
+private:
+	struct Slot
+	{
+		const void *key = nullptr;
+		xmlNodePtr node = nullptr;
+		// Entries stamped with an older epoch are empty.
+		std::uint32_t epoch = 0;
+		bool result = false;
+	};
+
+	std::size_t slotOf(const void *key, xmlNodePtr node) const;
+	void grow();
+
+	std::vector<Slot> slots_;
+	std::size_t used_ = 0;
+	std::uint32_t epoch_ = 1;
+};
+
+// Per-traversal state handed down by Selector::ForEachMatch.
+struct MatchContext
+{
+	using Marks = std::unordered_set<xmlNodePtr>;
+	using Collector = std::function<void(xmlNodePtr scope, NodeSet &found)>;
+	using Test = std::function<bool(xmlNodePtr)>;
+
+	bool useAncestorFilter = false;
+	AncestorFilter ancestors;
+
+	// Root of the traversal.
+	xmlNodePtr scope = nullptr;
+	// Node the traversal is at; inherited describes its ancestors.
+	xmlNodePtr current = nullptr;
+	// Started by the first inherited lookup, so traversals that never make
+	// one do not pay for it.
+	mutable InheritedState inherited;
+	// Set by SubtreeWalk; BinarySelector and UnarySelector keep their results
+	// on nodes other than the current one in it.
+	MatchMemo *memo = nullptr;
+
+	// Whether every descendant of node lies in the scope's subtree, so marks
+	// computed over the scope are exact for it.
+	bool covers(xmlNodePtr node) const;
+
+	// Elements with a descendant among the nodes collect finds in the scope.
+	// Computed on first use for each key and kept for the rest of the
+	// traversal, which turns :has() into a lookup instead of a subtree
+	// search per candidate.
+	const Marks &hasMarks(const void *key, const Collector &collect) const;
+
+	// Whether an element sibling before node passes test. The answer for the
+	// last node asked about under each parent is kept per key, so a traversal
+	// asking in document order resumes from it and tests each sibling once,
+	// instead of once per later sibling.
+	bool precededBy(const void *key, xmlNodePtr node, const Test &test) const;
+
+	// Whether the current node or one of its ancestors has a lang attribute
+	// equal to lang or starting with lang followed by '-'; lang must not be
+	// empty.
+	bool langMatches(std::string_view lang) const;
+
+private:
+	struct Siblings
+	{
+		// Last node asked about, and whether a sibling before it passed.
+		xmlNodePtr node = nullptr;
+		bool preceded = false;
+	};
+
+	mutable std::unordered_map<const void *, Marks> has_;
+	mutable std::unordered_map<const void *, std::unordered_map<xmlNodePtr, Siblings>> siblings_;
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <iterator>
+
+#include "MatchContext.h"
+#include "Node.h"
+#include "Selector.h"
+
+// Preorder walk over the subtree rooted at a node that descends into elements
+// only, keeping the ancestor filter and inherited state of a MatchContext
+// (when they are enabled) in step: when next() returns a node, they describe
+// exactly its ancestors, and the context's current node is set to it.
+// The walk follows the tree's own parent and sibling links and keeps no
+// stack.
+//
+// The tree must not be modified while a walk is in progress. The walk keeps
+// the results its selectors store in the context's memo, for its whole life.
+class SubtreeWalk
+{
+public:
+	SubtreeWalk(xmlNodePtr scope, MatchContext &context);
+	SubtreeWalk(const SubtreeWalk &) = delete;
+	SubtreeWalk &operator=(const SubtreeWalk &) = delete;
+
+	// Next node, or nullptr once the subtree is exhausted.
+	xmlNodePtr next();
+
+	// Leaves out the descendants of the node last returned.
+	void skipChildren() { descend_ = false; }
+
+	// Walks the subtree rooted at root from the start, root being a node
+	// within the scope. The context keeps the scope, and so whatever it
+	// computed over it.
+	void restart(xmlNodePtr root);
+
+private:
+	void enter(xmlNodePtr root);
+	xmlNodePtr advance(xmlNodePtr node);
+
+private:
+	MatchContext &context_;
+	MatchMemo memo_;
+	// Root of the subtree being walked.
+	xmlNodePtr root_;
+	// Node last returned.
+	xmlNodePtr current_ = nullptr;
+	bool started_ = false;
+	bool descend_ = true;
+};
+
+// Pull-based walk over the matches of a selector in the subtree rooted at a
+// node, in document order. Each call to next() resumes the walk where the
+// previous one stopped, so matches are produced one at a time without
+// collecting them.
+class MatchCursor
+{
+public:
+	MatchCursor(const Selector &selector, xmlNodePtr scope);
+	MatchCursor(const MatchCursor &) = delete;
+	MatchCursor &operator=(const MatchCursor &) = delete;
+
+	// Next match, or nullptr once the subtree is exhausted.
+	xmlNodePtr next();
+
+private:
+	const Selector &selector_;
+	MatchContext context_;
+	SubtreeWalk walk_;
+};
+
+// Range over the matches of a selector, for use in a range-based for loop.
+// Holds the selector, so the range may outlive the caller's reference to it.
+class MatchRange
+{
+public:
+	class iterator
+	{
+	public:
+		using iterator_category = std::input_iterator_tag;
+		using value_type = Node;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Node;
+
+		iterator() = default;
+		explicit iterator(MatchCursor *cursor) : cursor_(cursor), node_(cursor->next()) {}
+
+		Node operator*() const { return Node(node_); }
+
+		iterator &operator++()
+		{
+			node_ = cursor_->next();
+			return *this;
+		}
+
+		bool operator==(const iterator &other) const { return node_ == other.node_; }
+		bool operator!=(const iterator &other) const { return node_ != other.node_; }
+
+	private:
+		MatchCursor *cursor_ = nullptr;
+		xmlNodePtr node_ = nullptr;
+	};
+
+	MatchRange(SelectorPtr selector, xmlNodePtr scope) : selector_(std::move(selector)), cursor_(*selector_, scope) {}
+
+	// Starts the walk; a range can be iterated once.
+	iterator begin() { return iterator(&cursor_); }
+	iterator end() { return iterator(); }
+
+private:
+	SelectorPtr selector_;
+	MatchCursor cursor_;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include "ElementInfo.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// An interned, lowercased element or attribute name. Interning a name in any
+// case yields the same atom, so two atoms are equal exactly when they are the
+// same pointer. Atoms are never freed: the table starts with the HTML element
+// names and only selectors add to it, while documents merely look names up,
+// so parsing input never grows it.
+//
+// DocumentIndex records the atom of every element's name in its ElementInfo,
+// which turns name tests on those elements into a pointer compare. Other
+// nodes, and attributes, fall back to comparing the name in place.
+class NameAtom
+{
+public:
+	NameAtom(const NameAtom &) = delete;
+	NameAtom &operator=(const NameAtom &) = delete;
+
+	static const NameAtom *Intern(std::string_view name);
+	// Atom of name if it was already interned, or nullptr.
+	static const NameAtom *Find(std::string_view name);
+
+	// Atom recorded for an indexed element, or nullptr.
+	static const NameAtom *Of(xmlNodePtr node)
+	{
+		const ElementInfo *info = ElementInfo::Of(node);
+		return info != nullptr ? info->name : nullptr;
+	}
+
+	// Whether two elements have the same name, ignoring ASCII case.
+	static bool SameName(xmlNodePtr a, xmlNodePtr b);
+
+	const std::string &str() const { return name_; }
+	std::uint32_t tagKey() const { return tagKey_; }
+
+	// Whether name equals this atom, ignoring ASCII case.
+	bool Equals(const xmlChar *name) const;
+
+	bool Matches(xmlNodePtr element) const
+	{
+		const NameAtom *atom = Of(element);
+		return atom != nullptr ? atom == this : Equals(element->name);
+	}
+	bool Matches(xmlAttrPtr attr) const { return Equals(attr->name); }
+
+private:
+	struct Table;
+
+	explicit NameAtom(std::string name);
+
+	static Table &table();
+
+	std::string name_;
+	std::uint32_t tagKey_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Selector.h"
+
+#include <vector>
+
+// Intersection or union of any number of selectors, tested in order. Built by
+// SelectorOptimizer in place of chains of binary intersections and unions.
+class NarySelector : public Selector
+{
+public:
+    enum class Operator
+    {
+        Union,
+        Intersection
+    };
+
+    NarySelector() = delete;
+    NarySelector(Operator _operator, std::vector<SelectorPtr> selectors);
+    ~NarySelector() = default;
+    bool matches(xmlNodePtr node) const override;
+    bool matches(xmlNodePtr node, const MatchContext &context) const override;
+
+    void collectSubjectKeys(std::vector<std::uint32_t> &keys) const override;
+    void collectAncestorKeys(std::vector<std::uint32_t> &keys) const override;
+    bool usesAncestorFilter() const override { return usesAncestorFilter_; }
+
+    std::string toString() const override;
+
+    Operator getOperator() const { return operator_; }
+    const std::vector<SelectorPtr> &getSelectors() const { return selectors_; }
+
+private:
+    std::vector<SelectorPtr> selectors_;
+    Operator operator_;
+    bool usesAncestorFilter_;
+};
@@ -12,6 +12,7 @@
 #include "Helpers.h"
 
 class QueryResult;
+class MatchRange;
 
 class Node
 {
@@ -38,13 +39,33 @@ public:
 	QueryResult Siblings() const;
 	QueryResult Find(std::string_view) const;
 	QueryResult Find(const SelectorPtr) const;
+	QueryResult Find(std::string_view, std::size_t limit) const;
+	QueryResult Find(const SelectorPtr &, std::size_t limit) const;
+	std::optional<Node> FindFirst(std::string_view) const;
+	std::optional<Node> FindFirst(const SelectorPtr &) const;
+	bool Exists(std::string_view) const;
+	bool Exists(const SelectorPtr &) const;
+	std::size_t Count(std::string_view) const;
+	std::size_t Count(const SelectorPtr &) const;
+	// Calls visit on each match in document order until it returns false,
+	// without collecting the matches.
+	void ForEach(std::string_view, const std::function<bool(Node)> &visit) const;
+	void ForEach(const SelectorPtr &, const std::function<bool(Node)> &visit) const;
+	// Matches found one at a time as the range is iterated.
+	MatchRange Stream(std::string_view) const;
+	MatchRange Stream(const SelectorPtr &) const;
 	QueryResult PrevSiblings() const;
 	QueryResult Children() const;
 
 	bool HasAttribute(const std::string &key) const;
 	bool HasClass(const std::string &className) const;
 	std::vector<std::string> Classes() const;
+	// Whether this element matches selector.
+	bool Matches(std::string_view selector) const;
+	bool Matches(const SelectorPtr &selector) const;
+	// This element or its nearest ancestor matching selector.
 	std::optional<Node> Closest(std::string_view selector) const;
+	std::optional<Node> Closest(const SelectorPtr &selector) const;
 
 	std::optional<Node> FirstElementChild() const;
 	std::optional<Node> LastElementChild() const;
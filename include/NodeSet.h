@@ -0,0 +1,67 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <cstddef>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+// Contiguous set of nodes kept sorted in document order and free of duplicates.
+class NodeSet
+{
+public:
+	using container_type = std::vector<xmlNodePtr>;
+	using value_type = xmlNodePtr;
+	using size_type = std::size_t;
+	using iterator = container_type::const_iterator;
+	using const_iterator = container_type::const_iterator;
+
+	NodeSet() = default;
+	NodeSet(std::initializer_list<xmlNodePtr> nodes);
+	~NodeSet() = default;
+
+	iterator begin() const { return nodes_.cbegin(); }
+	iterator end() const { return nodes_.cend(); }
+	iterator cbegin() const { return nodes_.cbegin(); }
+	iterator cend() const { return nodes_.cend(); }
+
+	xmlNodePtr operator[](size_type i) const { return nodes_[i]; }
+	xmlNodePtr front() const { return nodes_.front(); }
+	xmlNodePtr back() const { return nodes_.back(); }
+
+	size_type size() const { return nodes_.size(); }
+	bool empty() const { return nodes_.empty(); }
+	void reserve(size_type n) { nodes_.reserve(n); }
+	void clear() { nodes_.clear(); }
+	// Keeps the first n nodes.
+	void truncate(size_type n)
+	{
+		if (n < nodes_.size())
+		{
+			nodes_.resize(n);
+		}
+	}
+
+	// Appends a node known to follow every stored node in document order.
+	void push_back(xmlNodePtr node) { nodes_.push_back(node); }
+
+	std::pair<iterator, bool> insert(xmlNodePtr node);
+	template <typename... Args>
+	std::pair<iterator, bool> emplace(Args &&...args) { return insert(xmlNodePtr(std::forward<Args>(args)...)); }
+
+	iterator find(xmlNodePtr node) const;
+	size_type count(xmlNodePtr node) const { return find(node) != end() ? 1 : 0; }
+
+	void merge(const NodeSet &other);
+
+	const container_type &data() const { return nodes_; }
+
+	bool operator==(const NodeSet &other) const { return nodes_ == other.nodes_; }
+	bool operator!=(const NodeSet &other) const { return nodes_ != other.nodes_; }
+
+	static bool DocumentOrderLess(xmlNodePtr a, xmlNodePtr b);
+
+private:
+	container_type nodes_;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <cstddef>
+
+#include "NodeSet.h"
+#include "Selector.h"
+
+// When a query may be split across threads (see Document::Find).
+struct ParallelOptions
+{
+	// Threads to use, the caller included; 0 uses one per hardware thread.
+	std::size_t threads = 0;
+	// Documents with fewer elements than this are searched serially.
+	std::size_t threshold = 50000;
+};
+
+// Matches a selector over a subtree with several threads. The subtree is cut
+// into subtree tasks on demand: a thread hands the children of the element it
+// is visiting to the pool only while another thread is out of work, and
+// otherwise keeps descending itself. Idle threads steal the oldest, and so
+// usually largest, pending tasks, and sleep while there are none.
+//
+// The threads persist across queries; a query made while another one has
+// them runs on the calling thread. Each thread walks all of its tasks with a
+// single context over the whole subtree, which it shares between them.
+//
+// Each task remembers where the tasks split off from it belong among its own
+// matches, so the per-task results are spliced back in document order without
+// sorting. The selector must be safe to evaluate from several threads, which
+// holds for every selector the parser builds.
+class ParallelMatcher
+{
+public:
+	static NodeSet MatchAll(const Selector &selector, xmlNodePtr scope, std::size_t threads);
+};
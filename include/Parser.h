@@ -18,7 +18,9 @@ public:
 	virtual ~SelectorParser() = default;
 
 public:
-	static SelectorPtr Create(std::string_view);
+	// optimize runs the parsed tree through SelectorOptimizer, compile then
+	// wraps it in a CompiledSelector.
+	static SelectorPtr Create(std::string_view, bool compile = false, bool optimize = false);
 
 protected:
 	SelectorPtr ParseSelectorGroup();
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// How DocumentIndex evaluates a selector over a subtree, as chosen by
+// DocumentIndex::Plan. Costs estimate the elements a strategy visits: those
+// it tests, plus the ancestors or siblings their combinators walk.
+struct QueryPlan
+{
+	enum class Strategy
+	{
+		// Test every element of the scope.
+		Scan,
+		// Test the elements carrying the subject's id, tag or class.
+		IdSeed,
+		TagSeed,
+		ClassSeed,
+		// Scan only the subtrees of the elements with an id every match must
+		// descend from, e.g. #main for `#main .item`.
+		ScopedDescent,
+		// Match each compound of a combinator chain against its own
+		// candidates and combine the lists with StructuralJoin.
+		StructuralJoin,
+		// Evaluate each branch of a selector group with its own plan.
+		Union,
+	};
+
+	struct Option
+	{
+		Strategy strategy;
+		std::string key;
+		std::size_t cost;
+	};
+
+	Strategy strategy = Strategy::Scan;
+	// Id, tag or class name the strategy looks up, if any.
+	std::string key;
+	std::size_t cost = 0;
+	// Cost of scanning the scope, for comparison.
+	std::size_t scanCost = 0;
+	// Every strategy that applied, the chosen one included.
+	std::vector<Option> considered;
+	// Plans of a Union's branches, in selector order.
+	std::vector<QueryPlan> branches;
+
+	static const char *StrategyName(Strategy strategy);
+
+	// Indented, human-readable description of the plan and its alternatives.
+	std::string toString() const;
+};
@@ -3,7 +3,6 @@
 #include "Selector.h"
 #include "Node.h"
 
-#include <set>
 #include <string>
 #include <optional>
 #include <iterator>
@@ -16,16 +15,19 @@
 class QueryResult
 {
 public:
-	using NodeSet = std::set<xmlNodePtr>;
+	using NodeSet = ::NodeSet;
 
 	class iterator
 	{
 	public:
-		using iterator_category = std::forward_iterator_tag;
+		using iterator_category = std::random_access_iterator_tag;
 		using value_type = Node;
 		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = Node;
 
-		iterator(NodeSet::iterator it) : iter_(it) {}
+		iterator() = default;
+		iterator(NodeSet::const_iterator it) : iter_(it) {}
 
 		iterator &operator++()
 		{
@@ -38,42 +40,60 @@ public:
 			++(*this);
 			return inter;
 		}
+		iterator &operator--()
+		{
+			--iter_;
+			return *this;
+		}
+		iterator operator--(int)
+		{
+			iterator inter = *this;
+			--(*this);
+			return inter;
+		}
 
 		Node operator*() const { return Node(*iter_); }
 
 		bool operator==(const iterator &other) const { return iter_ == other.iter_; }
 		bool operator!=(const iterator &other) const { return iter_ != other.iter_; }
+		bool operator<(const iterator &other) const { return iter_ < other.iter_; }
+		bool operator>(const iterator &other) const { return iter_ > other.iter_; }
+		bool operator<=(const iterator &other) const { return iter_ <= other.iter_; }
+		bool operator>=(const iterator &other) const { return iter_ >= other.iter_; }
 
 		iterator &operator+=(difference_type n)
 		{
-			std::advance(iter_, n);
+			iter_ += n;
 			return *this;
 		}
-
-		iterator operator+(difference_type n) const
+		iterator &operator-=(difference_type n)
 		{
-			iterator inter = *this;
-			std::advance(inter.iter_, n);
-			return inter;
+			iter_ -= n;
+			return *this;
 		}
 
-		difference_type operator-(const iterator &other) const { return std::distance(iter_, other.iter_); }
+		iterator operator+(difference_type n) const { return iterator(iter_ + n); }
+		iterator operator-(difference_type n) const { return iterator(iter_ - n); }
+		friend iterator operator+(difference_type n, const iterator &it) { return it + n; }
+
+		difference_type operator-(const iterator &other) const { return iter_ - other.iter_; }
 
-		Node operator[](difference_type n) const { return *(*this + n); }
+		Node operator[](difference_type n) const { return Node(iter_[n]); }
 
 	private:
-		NodeSet::iterator iter_;
+		NodeSet::const_iterator iter_;
 	};
 
 	QueryResult(xmlNodePtr node);
 	QueryResult(const NodeSet &nodes) : nodes_(nodes) {}
+	QueryResult(NodeSet &&nodes) : nodes_(std::move(nodes)) {}
 	~QueryResult() = default;
 
-	iterator begin();
-	iterator end();
+	iterator begin() const;
+	iterator end() const;
 
-	Node front() const { return *nodes_.cbegin(); }
-	Node back() const { return *std::prev(nodes_.cend()); }
+	Node front() const { return nodes_.front(); }
+	Node back() const { return nodes_.back(); }
 	bool empty() const { return nodes_.empty(); }
 
 	NodeSet operator()()
@@ -86,6 +106,30 @@ public:
 	QueryResult Find(const SelectorPtr &selector) const;
 	static QueryResult Find(xmlNodePtr node, std::string_view selector);
 	static QueryResult Find(xmlNodePtr node, const SelectorPtr &selector);
+	// Same, keeping only the first limit matches in document order; the
+	// search stops once they are found.
+	QueryResult Find(std::string_view selector, std::size_t limit) const;
+	QueryResult Find(const SelectorPtr &selector, std::size_t limit) const;
+	static QueryResult Find(xmlNodePtr node, std::string_view selector, std::size_t limit);
+	static QueryResult Find(xmlNodePtr node, const SelectorPtr &selector, std::size_t limit);
+	std::optional<Node> FindFirst(std::string_view selector) const;
+	std::optional<Node> FindFirst(const SelectorPtr &selector) const;
+	bool Exists(std::string_view selector) const;
+	bool Exists(const SelectorPtr &selector) const;
+	// Number of matches, without collecting them when no index applies.
+	std::size_t Count(std::string_view selector) const;
+	std::size_t Count(const SelectorPtr &selector) const;
+	// Calls visit on each match in document order until it returns false,
+	// without collecting the matches.
+	void ForEach(std::string_view selector, const std::function<bool(Node)> &visit) const;
+	void ForEach(const SelectorPtr &selector, const std::function<bool(Node)> &visit) const;
+	// Nearest ancestor-or-self of each node that matches selector. Ancestors
+	// shared by several nodes are tested once.
+	QueryResult Closest(std::string_view selector) const;
+	QueryResult Closest(const SelectorPtr &selector) const;
+	// Every proper ancestor of any node that matches selector.
+	QueryResult Parents(std::string_view selector) const;
+	QueryResult Parents(const SelectorPtr &selector) const;
 	std::optional<Node> at(std::size_t i) const;
 	std::size_t size() const;
 
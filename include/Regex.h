@@ -0,0 +1,52 @@
+#pragma once
+
+#include <memory>
+#include <regex>
+#include <string>
+#include <string_view>
+
+// A regular expression compiled once and shared by every node a selector
+// tests. Concurrent searches on the same instance are safe.
+//
+// Patterns use the ECMAScript syntax without backreferences or lookaround,
+// and run on a Thompson NFA whose states are cached as a lazily built DFA,
+// so a search takes time linear in the input whatever the pattern. Patterns
+// outside that subset are rejected unless the std::regex fallback is
+// enabled, which gives up the linear-time guarantee.
+//
+// A literal every match must contain is extracted from the pattern, so most
+// non-matching inputs are rejected by a plain substring search before the
+// automaton runs. Throws std::regex_error on an invalid or rejected pattern.
+class Regex
+{
+public:
+	Regex() = delete;
+	explicit Regex(std::string_view pattern);
+	Regex(const Regex &) = delete;
+	Regex &operator=(const Regex &) = delete;
+	~Regex();
+
+	bool search(std::string_view text) const;
+
+	const std::string &getPattern() const { return pattern_; }
+	const std::string &getLiteral() const { return literal_; }
+	bool isLinear() const { return program_ != nullptr; }
+
+	// Whether patterns the linear engine does not support are handed to
+	// std::regex instead of being rejected. Off by default; only affects
+	// Regex objects constructed afterwards.
+	static void SetStdFallback(bool enabled);
+	static bool StdFallback();
+
+	// Longest literal that occurs in every match of pattern, or an empty
+	// string when none can be proven.
+	static std::string RequiredLiteral(std::string_view pattern);
+
+private:
+	struct Program;
+
+	std::string pattern_;
+	std::string literal_;
+	std::unique_ptr<Program> program_;
+	std::unique_ptr<std::regex> fallback_;
+};
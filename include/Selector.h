@@ -2,24 +2,45 @@
 
 #include <libxml/HTMLparser.h>
 #include <libxml/tree.h>
-#include <set>
 
+#include <cstddef>
+#include <functional>
 #include <string>
 #include <regex>
 #include <memory>
 
+#include "MatchContext.h"
+#include "NodeSet.h"
+
 class Selector
 {
 public:
-    using NodeSet = std::set<xmlNodePtr>;
+    using NodeSet = ::NodeSet;
 
     Selector() = default;
     virtual bool matches(xmlNodePtr) const { return true; }
+    virtual bool matches(xmlNodePtr node, const MatchContext &) const { return matches(node); }
     virtual std::string toString() const { return "*"; };
     virtual NodeSet Filter(NodeSet nodes) const;
     virtual NodeSet MatchAll(xmlNodePtr node) const;
+    // First limit matches in document order; the traversal stops there.
+    NodeSet MatchAll(xmlNodePtr node, std::size_t limit) const;
+    std::size_t CountMatches(xmlNodePtr node) const;
+    // Calls visit on each match in the subtree rooted at node, in document
+    // order, until it returns false. Matches are not collected.
+    void ForEachMatch(xmlNodePtr node, const std::function<bool(xmlNodePtr)> &visit) const;
+    // Matches of each selector in the subtree rooted at node, found in a
+    // single walk. A selector is only tested on elements carrying every key
+    // from its collectSubjectKeys.
+    static std::vector<NodeSet> MatchMany(const std::vector<std::shared_ptr<Selector>> &selectors, xmlNodePtr node);
     virtual ~Selector() = default;
 
+    // Ancestor filter keys (see AncestorFilter): those any matching node must
+    // carry itself, and those that must appear among its ancestors.
+    virtual void collectSubjectKeys(std::vector<std::uint32_t> &) const {}
+    virtual void collectAncestorKeys(std::vector<std::uint32_t> &) const {}
+    virtual bool usesAncestorFilter() const { return false; }
+
 protected:
     void matchAllInto(xmlNodePtr node, NodeSet &nodes) const;
 };
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Selector.h"
+
+// Parsed selectors keyed by their text, shared by every string-based Find and
+// Closest so a selector used repeatedly is parsed once. Bounded: once full,
+// the least recently used entry is evicted. Safe to use from several threads.
+//
+// Parse errors are thrown to the caller and never cached.
+class SelectorCache
+{
+public:
+	struct Stats
+	{
+		std::uint64_t hits = 0;
+		std::uint64_t misses = 0;
+		std::uint64_t evictions = 0;
+		std::size_t size = 0;
+		std::size_t capacity = 0;
+	};
+
+	static constexpr std::size_t DefaultCapacity = 1024;
+
+	explicit SelectorCache(std::size_t capacity = DefaultCapacity) : capacity_(capacity) {}
+	SelectorCache(const SelectorCache &) = delete;
+	SelectorCache &operator=(const SelectorCache &) = delete;
+
+	// Cache used by the string-based query entry points.
+	static SelectorCache &Global();
+
+	// Selector parsed from text, as SelectorParser::Create would return it.
+	SelectorPtr get(std::string_view selector, bool compile = false);
+
+	// Parses every selector ahead of time, so later queries only hit.
+	void warm(const std::vector<std::string> &selectors, bool compile = false);
+
+	// A capacity of 0 disables caching; shrinking evicts the oldest entries.
+	void setCapacity(std::size_t capacity);
+	std::size_t getCapacity() const;
+
+	void clear();
+	Stats getStats() const;
+	void resetStats();
+
+private:
+	struct Entry
+	{
+		std::string text;
+		bool compile;
+		SelectorPtr selector;
+	};
+	using Entries = std::list<Entry>;
+	// Keys view the text owned by their entry.
+	using Index = std::unordered_map<std::string_view, Entries::iterator>;
+
+	void trim();
+
+private:
+	mutable std::mutex mutex_;
+	std::size_t capacity_;
+	// Most recently used first.
+	Entries entries_;
+	// One index per compile flag.
+	Index index_[2];
+	Stats stats_;
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Selector.h"
+
+// Rewrites a parsed selector into an equivalent one that is cheaper to match:
+//  - chains of intersections and unions become single NarySelector nodes;
+//  - their operands are ordered by CostOf(), cheapest first, so a compound
+//    fails on its tag or class before reaching :has() or :contains();
+//  - repeated operands are dropped;
+//  - subtrees that always or never match are folded: `*` in a compound is
+//    dropped, a union containing `*` becomes `*`, and anything that can never
+//    match (an uppercase tag name, :not(*), a compound or combinator over
+//    such a part) becomes :not(*).
+//
+// SelectorParser::Create runs it on request; SelectorCache, and so every
+// string-based query, always does.
+class SelectorOptimizer
+{
+public:
+	enum Cost
+	{
+		Universal,
+		Tag,
+		Id,
+		Class,
+		Attribute,
+		Structural,
+		Combinator,
+		Content,
+	};
+
+	static SelectorPtr Optimize(const SelectorPtr &selector);
+
+	// Estimated cost of testing selector on one element.
+	static Cost CostOf(const Selector &selector);
+};
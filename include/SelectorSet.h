@@ -0,0 +1,93 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "Selector.h"
+
+// A large collection of selectors ("rules") matched together, as a style
+// engine or a filter list does. Each rule is filed under one key of its
+// rightmost compound selector: its id, else its first class, else its tag
+// name; rules without one go on a list tried for every element. Matching an
+// element then only tries the rules filed under the element's own id, class
+// and tag keys instead of every rule in the set.
+//
+// A selector group ("a, b") is split into its branches, each filed on its
+// own under the rule's id; an element matched by several branches reports
+// the rule once.
+//
+// Adding rules is not safe while the set is being matched; matching is safe
+// from several threads at once.
+class SelectorSet
+{
+public:
+	using RuleId = std::size_t;
+
+	struct Match
+	{
+		xmlNodePtr node;
+		RuleId rule;
+
+		bool operator==(const Match &other) const { return node == other.node && rule == other.rule; }
+	};
+
+	SelectorSet() = default;
+	SelectorSet(const SelectorSet &) = delete;
+	SelectorSet &operator=(const SelectorSet &) = delete;
+
+	// Adds a rule and returns its id; ids are handed out in order from 0.
+	// Parse errors are thrown and leave the set unchanged.
+	RuleId add(std::string_view selector);
+	RuleId add(SelectorPtr selector);
+
+	std::size_t size() const { return rules_.size(); }
+	const std::string &getText(RuleId rule) const { return rules_[rule].text; }
+	const SelectorPtr &getSelector(RuleId rule) const { return rules_[rule].selector; }
+
+	// Rules matching element, in increasing order, appended to rules.
+	void match(xmlNodePtr element, std::vector<RuleId> &rules) const;
+
+	// Every (element, rule) match in the subtree rooted at scope, in document
+	// order and by increasing rule within an element.
+	std::vector<Match> matchAll(xmlNodePtr scope) const;
+
+	// Elements each rule has matched since the last reset.
+	std::uint64_t getHits(RuleId rule) const { return rules_[rule].hits.load(std::memory_order_relaxed); }
+	void resetHits();
+
+private:
+	struct Rule
+	{
+		Rule(std::string text, SelectorPtr selector) : text(std::move(text)), selector(std::move(selector)) {}
+
+		std::string text;
+		SelectorPtr selector;
+		mutable std::atomic<std::uint64_t> hits{0};
+	};
+
+	// One branch of a rule, filed under a key.
+	struct Entry
+	{
+		const Selector *selector;
+		RuleId rule;
+	};
+
+	RuleId insert(std::string text, SelectorPtr selector);
+	void file(const Selector *branch, RuleId rule);
+	void collect(xmlNodePtr element, const MatchContext *context, std::vector<std::uint32_t> &keys, std::vector<RuleId> &rules) const;
+
+private:
+	// Deque so rules, and their counters, stay in place as the set grows.
+	std::deque<Rule> rules_;
+	std::unordered_map<std::uint32_t, std::vector<Entry>> keyed_;
+	std::vector<Entry> universal_;
+	bool usesAncestorFilter_ = false;
+};
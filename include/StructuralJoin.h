@@ -0,0 +1,50 @@
+#pragma once
+
+#include <libxml/tree.h>
+
+#include <vector>
+
+#include "BinarySelector.h"
+#include "Selector.h"
+
+class DocumentIndex;
+
+// Set-at-a-time evaluation of combinators over an indexed document. Each
+// element's ElementInfo numbers it in document order and records the size of
+// its subtree, so the elements of a subtree form one interval and a combinator
+// over two document-ordered lists is a single merge-like pass with a stack of
+// open intervals, O(|left| + |right|), instead of a walk over the ancestors
+// or siblings of every candidate.
+//
+// Lists hold elements taken from the index passed along, in document order;
+// their intervals are read from that index and no other.
+class StructuralJoin
+{
+public:
+	using ElementList = std::vector<xmlNodePtr>;
+
+	// A compound selector of a combinator chain, with the combinator joining
+	// it to the compound before it; the first step's combinator is unused.
+	struct Step
+	{
+		const Selector *compound;
+		BinarySelector::Operator combinator;
+		bool adjacent;
+	};
+
+	// Splits selector into the compounds of a chain such as `ul > li a`,
+	// leftmost first. Returns false when selector is not a chain of at least
+	// two compounds.
+	static bool Decompose(const Selector &selector, std::vector<Step> &steps);
+
+	// Elements of right related to an element of left by combinator.
+	static ElementList Join(const DocumentIndex &index, const ElementList &left, const ElementList &right, BinarySelector::Operator combinator, bool adjacent);
+
+	// Elements of nodes with an ancestor, or a parent, in ancestors.
+	static ElementList Descendants(const DocumentIndex &index, const ElementList &ancestors, const ElementList &nodes);
+	static ElementList Children(const DocumentIndex &index, const ElementList &parents, const ElementList &nodes);
+	// Elements of nodes whose previous element sibling, or any earlier one, is
+	// in siblings.
+	static ElementList NextSiblings(const ElementList &siblings, const ElementList &nodes);
+	static ElementList FollowingSiblings(const DocumentIndex &index, const ElementList &siblings, const ElementList &nodes);
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Selector.h"
+#include "NameAtom.h"
 
 class TagSelector : public Selector
 {
@@ -24,12 +25,22 @@ public:
     TagSelector(Operator _operator, std::string_view refval) : operator_(_operator), oftype_(false), a_(0), b_(0), last_(false), refvalue_(refval) {}
     TagSelector(bool oftype) : operator_(Operator::OnlyChild), oftype_(oftype), a_(0), b_(0), last_(false), refvalue_("") {}
     TagSelector(int a, int b, bool last, bool oftype) : operator_(Operator::NthChild), oftype_(oftype), a_(a), b_(b), last_(last), refvalue_("") {}
-    TagSelector(std::string_view tagname) : operator_(Operator::Tag), oftype_(false), a_(0), b_(0), last_(false), refvalue_(tagname) {}
+    TagSelector(std::string_view tagname);
     ~TagSelector() = default;
     bool matches(xmlNodePtr node) const override;
+    bool matches(xmlNodePtr node, const MatchContext &context) const override;
+    void collectSubjectKeys(std::vector<std::uint32_t> &keys) const override;
 
     std::string toString() const override;
 
+    Operator getOperator() const { return operator_; }
+    const std::string &getRefValue() const { return refvalue_; }
+    bool isOfType() const { return oftype_; }
+    int getA() const { return a_; }
+    int getB() const { return b_; }
+    bool isLast() const { return last_; }
+    const NameAtom *getAtom() const { return atom_; }
+
 private:
     Operator operator_;
 
@@ -39,4 +50,6 @@ private:
     bool last_;
 
     std::string refvalue_;
+    // Interned refvalue_ for Tag; nullptr when refvalue_ can never match.
+    const NameAtom *atom_ = nullptr;
 };
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "Selector.h"
+#include "Regex.h"
+
+#include <memory>
+#include <vector>
 
 class TextSelector : public Selector
 {
@@ -14,14 +18,20 @@ public:
     };
 
     TextSelector() = delete;
-    TextSelector(Operator _operator, std::string_view value) : value_(value), operator_(_operator) {}
+    TextSelector(Operator _operator, std::string_view value);
     ~TextSelector() = default;
 
     bool matches(xmlNodePtr node) const override;
 
     std::string toString() const override;
 
+    Operator getOperator() const { return operator_; }
+    const std::string &getValue() const { return value_; }
+
 private:
     std::string value_;
     Operator operator_;
+    std::shared_ptr<const Regex> regex_;
+    // KMP failure function of value_ for the streaming :contains() search.
+    std::vector<std::size_t> failure_;
 };
\ No newline at end of file
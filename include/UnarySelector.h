@@ -16,8 +16,16 @@ public:
     UnarySelector(Operator _operator, SelectorPtr selector) : selector_(selector), operator_(_operator) {}
     ~UnarySelector() = default;
     bool matches(xmlNodePtr node) const override;
+    bool matches(xmlNodePtr node, const MatchContext &context) const override;
+    bool usesAncestorFilter() const override;
     std::string toString() const override;
 
+    Operator getOperator() const { return operator_; }
+    const SelectorPtr &getSelector() const { return selector_; }
+
+private:
+    bool matchesWith(xmlNodePtr node, const MatchContext &context) const;
+
 private:
     // bool hasDescendantMatch(xmlNodePtr node, SelectorPtr selector) const;
     // bool hasChildMatch(xmlNodePtr node, SelectorPtr selector) const;
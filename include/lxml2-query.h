@@ -2,12 +2,27 @@
 
 #include "AttributeSelector.h"
 #include "BinarySelector.h"
+#include "CompiledSelector.h"
 #include "Document.h"
+#include "DocumentIndex.h"
+#include "ElementInfo.h"
 #include "Helpers.h"
+#include "MatchContext.h"
+#include "MatchCursor.h"
+#include "NameAtom.h"
+#include "NarySelector.h"
 #include "Node.h"
+#include "NodeSet.h"
+#include "ParallelMatcher.h"
 #include "Parser.h"
+#include "QueryPlan.h"
 #include "QueryResult.h"
+#include "Regex.h"
 #include "Selector.h"
+#include "SelectorCache.h"
+#include "SelectorOptimizer.h"
+#include "SelectorSet.h"
+#include "StructuralJoin.h"
 #include "TagSelector.h"
 #include "TextSelector.h"
 #include "UnarySelector.h"
@@ -22,7 +22,7 @@ bool AttributeSelector::matches(xmlNodePtr node) const
 		{
 			std::cout << "[UTF-8]: v:'" << toLower(normalizeHtmlText((char *)attr->name)) << "' r:'" << key_ << "' " << std::endl;
 		}*/
-		if (key_ != toLower(normalizeHtmlText(reinterpret_cast<const char*>(attr->name))))
+		if (!atom_->Matches(attr))
 		{
 			attr = attr->next;
 			continue;
@@ -62,7 +62,7 @@ bool AttributeSelector::matches(xmlNodePtr node) const
 		case Operator::SubString:
 			return value.find(value_) != std::string::npos;
 		case Operator::Regex:
-			return std::regex_search(value, std::regex(value_));
+			return regex_->search(value);
 		default:
 			return false;
 		}
@@ -72,6 +72,22 @@ bool AttributeSelector::matches(xmlNodePtr node) const
 	return false;
 }
 
+void AttributeSelector::collectSubjectKeys(std::vector<std::uint32_t> &keys) const
+{
+	if (value_.empty())
+	{
+		return;
+	}
+	if (operator_ == Operator::Equals && key_ == "id")
+	{
+		keys.push_back(AncestorFilter::IdKey(value_));
+	}
+	else if (operator_ == Operator::Includes && key_ == "class" && value_.find_first_of(" \t\n\r\f\v") == std::string::npos)
+	{
+		keys.push_back(AncestorFilter::ClassKey(value_));
+	}
+}
+
 std::string AttributeSelector::toString() const
 {
 	std::stringstream ss;
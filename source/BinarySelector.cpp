@@ -1,15 +1,22 @@
 #include "BinarySelector.h"
 
-static inline bool descendant(SelectorPtr lselector_, SelectorPtr rselector_, xmlNodePtr node)
+#include <algorithm>
+
+static inline bool test(const Selector &selector, xmlNodePtr node, const MatchContext *context)
 {
-	if (!rselector_->matches(node) || node->type != XML_ELEMENT_NODE)
+	return context != nullptr ? selector.matches(node, *context) : selector.matches(node);
+}
+
+static inline bool descendant(const Selector &lselector_, const Selector &rselector_, xmlNodePtr node, const MatchContext *context)
+{
+	if (!test(rselector_, node, context) || node->type != XML_ELEMENT_NODE)
 	{
 		return false;
 	}
 
 	for (xmlNodePtr parent = node->parent; parent != nullptr; parent = parent->parent)
 	{
-		if (lselector_->matches(parent))
+		if (test(lselector_, parent, context))
 		{
 			return true;
 		}
@@ -17,9 +24,9 @@ static inline bool descendant(SelectorPtr lselector_, SelectorPtr rselector_, xm
 	return false;
 }
 
-static inline bool adjacent(SelectorPtr lselector_, SelectorPtr rselector_, xmlNodePtr node, bool adjacent_)
+static inline bool adjacent(const Selector &lselector_, const Selector &rselector_, xmlNodePtr node, bool adjacent_, const MatchContext *context)
 {
-	if (!rselector_->matches(node) || node->type != XML_ELEMENT_NODE)
+	if (!test(rselector_, node, context) || node->type != XML_ELEMENT_NODE)
 	{
 		return false;
 	}
@@ -31,9 +38,9 @@ static inline bool adjacent(SelectorPtr lselector_, SelectorPtr rselector_, xmlN
 		}
 		if (adjacent_)
 		{
-			return lselector_->matches(sibling);
+			return test(lselector_, sibling, context);
 		}
-		if (lselector_->matches(sibling))
+		if (test(lselector_, sibling, context))
 		{
 			return true;
 		}
@@ -41,7 +48,79 @@ static inline bool adjacent(SelectorPtr lselector_, SelectorPtr rselector_, xmlN
 	return false;
 }
 
+void BinarySelector::initAncestorFilter()
+{
+	if (operator_ == Operator::Child || operator_ == Operator::Descendant)
+	{
+		lselector_->collectSubjectKeys(filterKeys_);
+		lselector_->collectAncestorKeys(filterKeys_);
+		std::sort(filterKeys_.begin(), filterKeys_.end());
+		filterKeys_.erase(std::unique(filterKeys_.begin(), filterKeys_.end()), filterKeys_.end());
+	}
+	usesAncestorFilter_ = !filterKeys_.empty() || lselector_->usesAncestorFilter() || rselector_->usesAncestorFilter();
+}
+
+void BinarySelector::collectSubjectKeys(std::vector<std::uint32_t> &keys) const
+{
+	switch (operator_)
+	{
+	case Operator::Intersection:
+		lselector_->collectSubjectKeys(keys);
+		rselector_->collectSubjectKeys(keys);
+		break;
+	case Operator::Child:
+	case Operator::Descendant:
+	case Operator::Adjacent:
+		rselector_->collectSubjectKeys(keys);
+		break;
+	default:
+		break;
+	}
+}
+
+void BinarySelector::collectAncestorKeys(std::vector<std::uint32_t> &keys) const
+{
+	switch (operator_)
+	{
+	case Operator::Child:
+	case Operator::Descendant:
+		keys.insert(keys.end(), filterKeys_.begin(), filterKeys_.end());
+		rselector_->collectAncestorKeys(keys);
+		break;
+	case Operator::Intersection:
+	case Operator::Adjacent:
+		lselector_->collectAncestorKeys(keys);
+		rselector_->collectAncestorKeys(keys);
+		break;
+	default:
+		break;
+	}
+}
+
 bool BinarySelector::matches(xmlNodePtr node) const
+{
+	return matchesWith(node, nullptr);
+}
+
+bool BinarySelector::matches(xmlNodePtr node, const MatchContext &context) const
+{
+	// Combinators nested on the left are tested on the same ancestors and
+	// siblings for every candidate; the current node is tested only once.
+	if (context.memo == nullptr || node == context.current || operator_ == Operator::Union || operator_ == Operator::Intersection)
+	{
+		return matchesWith(node, &context);
+	}
+	int known = context.memo->find(this, node);
+	if (known >= 0)
+	{
+		return known != 0;
+	}
+	bool result = matchesWith(node, &context);
+	context.memo->insert(this, node, result);
+	return result;
+}
+
+bool BinarySelector::matchesWith(xmlNodePtr node, const MatchContext *context) const
 {
 	if (!node)
 	{
@@ -51,28 +130,51 @@ bool BinarySelector::matches(xmlNodePtr node) const
 	{
 	case Operator::Union:
 	{
-		if (lselector_->matches(node))
+		if (test(*lselector_, node, context))
 		{
 			return true;
 		}
-		return rselector_->matches(node);
+		return test(*rselector_, node, context);
 	}
 	case Operator::Intersection:
-		if (!lselector_->matches(node))
+		if (!test(*lselector_, node, context))
 		{
 			return false;
 		}
-		return rselector_->matches(node);
+		return test(*rselector_, node, context);
 	case Operator::Child:
-		if (!rselector_->matches(node) || node->parent == nullptr)
+		if (context != nullptr && context->useAncestorFilter && !context->ancestors.mayContainAll(filterKeys_))
+		{
+			return false;
+		}
+		if (!test(*rselector_, node, context) || node->parent == nullptr)
 		{
 			return false;
 		}
-		return lselector_->matches(node->parent) && node->parent->type == XML_ELEMENT_NODE;
+		return test(*lselector_, node->parent, context) && node->parent->type == XML_ELEMENT_NODE;
 	case Operator::Descendant:
-		return descendant(lselector_, rselector_, node);
+		if (context != nullptr && context->useAncestorFilter && !context->ancestors.mayContainAll(filterKeys_))
+		{
+			return false;
+		}
+		if (context != nullptr && context->memo != nullptr)
+		{
+			return test(*rselector_, node, context) && node->type == XML_ELEMENT_NODE && hasMatchingAncestor(node, *context);
+		}
+		return descendant(*lselector_, *rselector_, node, context);
 	case Operator::Adjacent:
-		return adjacent(lselector_, rselector_, node, adjacent_);
+		if (!adjacent_ && context != nullptr)
+		{
+			// Traversals test siblings in order, so the context can carry
+			// what earlier ones found.
+			if (!test(*rselector_, node, context) || node->type != XML_ELEMENT_NODE)
+			{
+				return false;
+			}
+			return context->precededBy(this, node, [this, context](xmlNodePtr sibling)
+									   { return test(*lselector_, sibling, context); });
+		}
+		return adjacent(*lselector_, *rselector_, node, adjacent_, context);
 	default:
 		return false;
 	}
@@ -80,6 +182,41 @@ bool BinarySelector::matches(xmlNodePtr node) const
 	return false;
 }
 
+bool BinarySelector::hasMatchingAncestor(xmlNodePtr node, const MatchContext &context) const
+{
+	// Memo entries under &lselector_ record whether an element or one of its
+	// ancestors matches lselector_, so each ancestor is tested once however
+	// many candidates share it.
+	const void *key = &lselector_;
+
+	bool found = false;
+	xmlNodePtr stop = nullptr;
+	for (xmlNodePtr parent = node->parent; parent != nullptr; parent = parent->parent)
+	{
+		int known = context.memo->find(key, parent);
+		if (known >= 0)
+		{
+			found = known != 0;
+			stop = parent;
+			break;
+		}
+		if (test(*lselector_, parent, &context))
+		{
+			found = true;
+			stop = parent->parent;
+			context.memo->insert(key, parent, true);
+			break;
+		}
+	}
+
+	// Every ancestor passed on the way up shares the answer.
+	for (xmlNodePtr parent = node->parent; parent != stop && parent != nullptr; parent = parent->parent)
+	{
+		context.memo->insert(key, parent, found);
+	}
+	return found;
+}
+
 std::string BinarySelector::toString() const
 {
 	switch (operator_)
@@ -0,0 +1,786 @@
+#include "CompiledSelector.h"
+
+#include "AttributeSelector.h"
+#include "BinarySelector.h"
+#include "NarySelector.h"
+#include "TagSelector.h"
+#include "TextSelector.h"
+#include "UnarySelector.h"
+
+#include <algorithm>
+#include <sstream>
+#include <typeinfo>
+
+namespace
+{
+	struct Choice
+	{
+		std::uint32_t pc;
+		xmlNodePtr node;
+	};
+
+	// Backtracking stack with inline storage; selectors rarely nest deep
+	// enough to spill into the heap.
+	class ChoiceStack
+	{
+	public:
+		bool empty() const { return size_ == 0; }
+
+		void push(std::uint32_t pc, xmlNodePtr node)
+		{
+			if (size_ < kInline)
+			{
+				inline_[size_] = Choice{pc, node};
+			}
+			else
+			{
+				overflow_.push_back(Choice{pc, node});
+			}
+			size_++;
+		}
+
+		Choice pop()
+		{
+			size_--;
+			if (size_ < kInline)
+			{
+				return inline_[size_];
+			}
+			Choice choice = overflow_.back();
+			overflow_.pop_back();
+			return choice;
+		}
+
+	private:
+		static constexpr std::size_t kInline = 16;
+
+		Choice inline_[kInline];
+		std::vector<Choice> overflow_;
+		std::size_t size_ = 0;
+	};
+
+	static inline xmlNodePtr prevElementSibling(xmlNodePtr node)
+	{
+		for (xmlNodePtr sibling = node->prev; sibling != nullptr; sibling = sibling->prev)
+		{
+			if (sibling->type == XML_ELEMENT_NODE)
+			{
+				return sibling;
+			}
+		}
+		return nullptr;
+	}
+
+	static const char *const statsHeader = "lxml2-query selector stats 1";
+
+	// Relative cost of one test, for ordering the tests of a group.
+	static double testCost(CompiledSelector::Opcode op)
+	{
+		switch (op)
+		{
+		case CompiledSelector::Opcode::Tag:
+			return 1;
+		case CompiledSelector::Opcode::Attribute:
+			return 2;
+		case CompiledSelector::Opcode::Pseudo:
+		case CompiledSelector::Opcode::Call:
+			return 4;
+		case CompiledSelector::Opcode::Sub:
+		case CompiledSelector::Opcode::Not:
+		case CompiledSelector::Opcode::HasChild:
+			return 8;
+		default:
+			return 32;
+		}
+	}
+
+	static const char *opcodeName(CompiledSelector::Opcode op)
+	{
+		switch (op)
+		{
+		case CompiledSelector::Opcode::Tag:
+			return "tag";
+		case CompiledSelector::Opcode::Attribute:
+			return "attr";
+		case CompiledSelector::Opcode::Pseudo:
+			return "pseudo";
+		case CompiledSelector::Opcode::Text:
+			return "text";
+		case CompiledSelector::Opcode::Call:
+			return "call";
+		case CompiledSelector::Opcode::Sub:
+			return "sub";
+		case CompiledSelector::Opcode::Not:
+			return "not";
+		case CompiledSelector::Opcode::Has:
+			return "has";
+		case CompiledSelector::Opcode::HasChild:
+			return "has-child";
+		case CompiledSelector::Opcode::Group:
+			return "group";
+		case CompiledSelector::Opcode::IsElement:
+			return "is-element";
+		case CompiledSelector::Opcode::Filter:
+			return "filter";
+		case CompiledSelector::Opcode::Parent:
+			return "parent";
+		case CompiledSelector::Opcode::Ancestor:
+			return "ancestor";
+		case CompiledSelector::Opcode::PrevSibling:
+			return "prev-sibling";
+		case CompiledSelector::Opcode::PrevSiblings:
+			return "prev-siblings";
+		case CompiledSelector::Opcode::Fork:
+			return "fork";
+		case CompiledSelector::Opcode::Match:
+			return "match";
+		default:
+			return "?";
+		}
+	}
+} // namespace
+
+CompiledSelector::CompiledSelector(SelectorPtr source, bool adaptive) : source_(source), adaptive_(adaptive)
+{
+	compileProgram(source_, true);
+}
+
+void CompiledSelector::emit(std::uint32_t program, Opcode op, std::uint32_t arg)
+{
+	programs_[program].push_back(Instruction{op, arg});
+}
+
+void CompiledSelector::emitTest(std::uint32_t program, Opcode op, const Selector *source, std::uint32_t arg)
+{
+	emit(program, op, arg);
+	if (labels_ != nullptr)
+	{
+		labels_->push_back(source->toString());
+	}
+}
+
+std::uint32_t CompiledSelector::addOperand(const Selector *selector)
+{
+	operands_.push_back(selector);
+	return static_cast<std::uint32_t>(operands_.size() - 1);
+}
+
+std::uint32_t CompiledSelector::compileProgram(const SelectorPtr &selector, bool atCandidate)
+{
+	programs_.emplace_back();
+	std::uint32_t program = static_cast<std::uint32_t>(programs_.size() - 1);
+	compileChain(program, selector, atCandidate);
+	return program;
+}
+
+void CompiledSelector::compileChain(std::uint32_t program, const SelectorPtr &selector, bool atCandidate)
+{
+	const auto *list = dynamic_cast<const NarySelector *>(selector.get());
+	if (list != nullptr && list->getOperator() == NarySelector::Operator::Union)
+	{
+		const std::vector<SelectorPtr> &branches = list->getSelectors();
+		for (std::size_t i = 0; i + 1 < branches.size(); i++)
+		{
+			std::size_t fork = programs_[program].size();
+			emit(program, Opcode::Fork);
+			compileChain(program, branches[i], atCandidate);
+			programs_[program][fork].arg = static_cast<std::uint32_t>(programs_[program].size());
+		}
+		compileChain(program, branches.back(), atCandidate);
+		return;
+	}
+
+	const auto *binary = dynamic_cast<const BinarySelector *>(selector.get());
+
+	if (binary == nullptr || binary->getOperator() == BinarySelector::Operator::Intersection)
+	{
+		compileCompound(program, selector, atCandidate);
+		emit(program, Opcode::Match);
+		return;
+	}
+
+	if (binary->getOperator() == BinarySelector::Operator::Union)
+	{
+		std::size_t fork = programs_[program].size();
+		emit(program, Opcode::Fork);
+		compileChain(program, binary->getLeft(), atCandidate);
+		programs_[program][fork].arg = static_cast<std::uint32_t>(programs_[program].size());
+		compileChain(program, binary->getRight(), atCandidate);
+		return;
+	}
+
+	if (atCandidate)
+	{
+		std::vector<std::uint32_t> keys;
+		binary->collectAncestorKeys(keys);
+		if (!keys.empty())
+		{
+			keys_.push_back(std::move(keys));
+			emit(program, Opcode::Filter, static_cast<std::uint32_t>(keys_.size() - 1));
+		}
+	}
+
+	compileCompound(program, binary->getRight(), atCandidate);
+
+	switch (binary->getOperator())
+	{
+	case BinarySelector::Operator::Child:
+		emit(program, Opcode::Parent);
+		break;
+	case BinarySelector::Operator::Descendant:
+		emit(program, Opcode::IsElement);
+		emit(program, Opcode::Ancestor);
+		break;
+	default:
+		emit(program, Opcode::IsElement);
+		emit(program, binary->isAdjacent() ? Opcode::PrevSibling : Opcode::PrevSiblings);
+		break;
+	}
+
+	// The left-hand side runs on an ancestor or sibling, which keeps the
+	// ancestor filter a (safe) superset but no longer worth consulting.
+	compileChain(program, binary->getLeft(), false);
+}
+
+void CompiledSelector::compileCompound(std::uint32_t program, const SelectorPtr &selector, bool atCandidate)
+{
+	if (!adaptive_)
+	{
+		compileTest(program, selector, atCandidate);
+		return;
+	}
+
+	// Tests compiled for nested programs label their own compounds.
+	std::vector<std::string> labels;
+	std::vector<std::string> *outer = labels_;
+	labels_ = &labels;
+	std::size_t begin = programs_[program].size();
+	compileTest(program, selector, atCandidate);
+	labels_ = outer;
+
+	std::size_t count = std::min(programs_[program].size() - begin, MaxGroupSize);
+	if (count < 2)
+	{
+		return;
+	}
+
+	Group &group = groups_.emplace_back();
+	auto first = programs_[program].begin() + static_cast<std::ptrdiff_t>(begin);
+	group.tests.assign(first, first + static_cast<std::ptrdiff_t>(count));
+	group.labels.assign(labels.begin(), labels.begin() + static_cast<std::ptrdiff_t>(count));
+	std::uint64_t order = 0;
+	for (std::size_t i = 0; i < count; i++)
+	{
+		group.counters.emplace_back();
+		order |= static_cast<std::uint64_t>(i) << (4 * i);
+	}
+	group.order.store(order, std::memory_order_relaxed);
+
+	// The group takes the place of its tests; any beyond MaxGroupSize follow.
+	programs_[program].erase(first, first + static_cast<std::ptrdiff_t>(count));
+	programs_[program].insert(programs_[program].begin() + static_cast<std::ptrdiff_t>(begin), Instruction{Opcode::Group, static_cast<std::uint32_t>(groups_.size() - 1)});
+}
+
+void CompiledSelector::compileTest(std::uint32_t program, const SelectorPtr &selector, bool atCandidate)
+{
+	const Selector *raw = selector.get();
+
+	if (typeid(*raw) == typeid(Selector))
+	{
+		return;
+	}
+
+	if (const auto *tag = dynamic_cast<const TagSelector *>(raw))
+	{
+		if (tag->getOperator() == TagSelector::Operator::Tag && tag->getAtom() != nullptr)
+		{
+			names_.push_back(tag->getAtom());
+			emitTest(program, Opcode::Tag, raw, static_cast<std::uint32_t>(names_.size() - 1));
+		}
+		else
+		{
+			emitTest(program, Opcode::Pseudo, raw, addOperand(raw));
+		}
+		return;
+	}
+
+	if (dynamic_cast<const AttributeSelector *>(raw) != nullptr)
+	{
+		emitTest(program, Opcode::Attribute, raw, addOperand(raw));
+		return;
+	}
+
+	if (dynamic_cast<const TextSelector *>(raw) != nullptr)
+	{
+		emitTest(program, Opcode::Text, raw, addOperand(raw));
+		return;
+	}
+
+	if (const auto *unary = dynamic_cast<const UnarySelector *>(raw))
+	{
+		switch (unary->getOperator())
+		{
+		case UnarySelector::Operator::Not:
+			emitTest(program, Opcode::Not, raw, compileProgram(unary->getSelector(), atCandidate));
+			return;
+		case UnarySelector::Operator::HasDescendant:
+			emitTest(program, Opcode::Has, raw, compileProgram(unary->getSelector(), false));
+			return;
+		case UnarySelector::Operator::HasChild:
+			emitTest(program, Opcode::HasChild, raw, compileProgram(unary->getSelector(), false));
+			return;
+		default:
+			break;
+		}
+	}
+
+	if (const auto *list = dynamic_cast<const NarySelector *>(raw))
+	{
+		if (list->getOperator() == NarySelector::Operator::Intersection)
+		{
+			for (const SelectorPtr &operand : list->getSelectors())
+			{
+				compileTest(program, operand, atCandidate);
+			}
+		}
+		else
+		{
+			emitTest(program, Opcode::Sub, raw, compileProgram(selector, atCandidate));
+		}
+		return;
+	}
+
+	if (const auto *binary = dynamic_cast<const BinarySelector *>(raw))
+	{
+		if (binary->getOperator() == BinarySelector::Operator::Intersection)
+		{
+			compileTest(program, binary->getLeft(), atCandidate);
+			compileTest(program, binary->getRight(), atCandidate);
+		}
+		else
+		{
+			emitTest(program, Opcode::Sub, raw, compileProgram(selector, atCandidate));
+		}
+		return;
+	}
+
+	emitTest(program, Opcode::Call, raw, addOperand(raw));
+}
+
+bool CompiledSelector::matches(xmlNodePtr node) const
+{
+	if (node == nullptr)
+	{
+		return false;
+	}
+	return run(0, node, nullptr);
+}
+
+bool CompiledSelector::matches(xmlNodePtr node, const MatchContext &context) const
+{
+	if (node == nullptr)
+	{
+		return false;
+	}
+	return run(0, node, &context);
+}
+
+bool CompiledSelector::run(std::uint32_t program, xmlNodePtr node, const MatchContext *context) const
+{
+	const Instruction *code = programs_[program].data();
+	std::uint32_t pc = 0;
+	ChoiceStack choices;
+
+	for (;;)
+	{
+		bool ok = true;
+		const Instruction &ins = code[pc];
+
+		switch (ins.op)
+		{
+		case Opcode::Tag:
+		case Opcode::Attribute:
+		case Opcode::Pseudo:
+		case Opcode::Text:
+		case Opcode::Call:
+		case Opcode::Sub:
+		case Opcode::Not:
+		case Opcode::Has:
+		case Opcode::HasChild:
+			ok = test(ins, node, context);
+			break;
+		case Opcode::Group:
+			ok = runGroup(groups_[ins.arg], node, context);
+			break;
+		case Opcode::IsElement:
+			ok = node->type == XML_ELEMENT_NODE;
+			break;
+		case Opcode::Filter:
+			ok = context == nullptr || !context->useAncestorFilter || context->ancestors.mayContainAll(keys_[ins.arg]);
+			break;
+		case Opcode::Parent:
+			node = node->parent;
+			ok = node != nullptr && node->type == XML_ELEMENT_NODE;
+			break;
+		case Opcode::Ancestor:
+			node = node->parent;
+			ok = node != nullptr;
+			if (ok)
+			{
+				choices.push(pc, node);
+			}
+			break;
+		case Opcode::PrevSibling:
+			node = prevElementSibling(node);
+			ok = node != nullptr;
+			break;
+		case Opcode::PrevSiblings:
+			node = prevElementSibling(node);
+			ok = node != nullptr;
+			if (ok)
+			{
+				choices.push(pc, node);
+			}
+			break;
+		case Opcode::Fork:
+			choices.push(ins.arg, node);
+			break;
+		case Opcode::Match:
+			return true;
+		default:
+			ok = false;
+			break;
+		}
+
+		if (ok)
+		{
+			pc++;
+			continue;
+		}
+
+		if (choices.empty())
+		{
+			return false;
+		}
+
+		// Re-running an Ancestor/PrevSiblings choice moves on from the node it
+		// last tried; a Fork choice starts the alternative branch.
+		Choice choice = choices.pop();
+		node = choice.node;
+		pc = choice.pc;
+	}
+}
+
+bool CompiledSelector::test(const Instruction &ins, xmlNodePtr node, const MatchContext *context) const
+{
+	bool ok = false;
+
+	switch (ins.op)
+	{
+	case Opcode::Tag:
+		ok = node->type == XML_ELEMENT_NODE && node->name != nullptr && names_[ins.arg]->Matches(node);
+		break;
+	case Opcode::Attribute:
+		ok = static_cast<const AttributeSelector *>(operands_[ins.arg])->AttributeSelector::matches(node);
+		break;
+	case Opcode::Pseudo:
+		ok = context != nullptr ? static_cast<const TagSelector *>(operands_[ins.arg])->TagSelector::matches(node, *context) : static_cast<const TagSelector *>(operands_[ins.arg])->TagSelector::matches(node);
+		break;
+	case Opcode::Text:
+		ok = static_cast<const TextSelector *>(operands_[ins.arg])->TextSelector::matches(node);
+		break;
+	case Opcode::Call:
+		ok = operands_[ins.arg]->matches(node);
+		break;
+	case Opcode::Sub:
+		ok = run(ins.arg, node, context);
+		break;
+	case Opcode::Not:
+		ok = !run(ins.arg, node, context);
+		break;
+	case Opcode::Has:
+	{
+		if (node->type != XML_ELEMENT_NODE || node->children == nullptr)
+		{
+			break;
+		}
+		if (context != nullptr && context->covers(node))
+		{
+			ok = context->hasMarks(&programs_[ins.arg], [this, &ins](xmlNodePtr scope, NodeSet &found)
+								   { collect(ins.arg, scope, found); })
+					 .count(node) != 0;
+			break;
+		}
+		std::vector<xmlNodePtr> stack;
+		stack.push_back(node);
+		while (!ok && !stack.empty())
+		{
+			xmlNodePtr current = stack.back();
+			stack.pop_back();
+			for (xmlNodePtr child = current->children; child != nullptr; child = child->next)
+			{
+				if (child->type != XML_ELEMENT_NODE)
+				{
+					continue;
+				}
+				if (run(ins.arg, child, nullptr))
+				{
+					ok = true;
+					break;
+				}
+				stack.push_back(child);
+			}
+		}
+		break;
+	}
+	case Opcode::HasChild:
+		if (node->type != XML_ELEMENT_NODE)
+		{
+			break;
+		}
+		for (xmlNodePtr child = node->children; child != nullptr; child = child->next)
+		{
+			if (child->type == XML_ELEMENT_NODE && run(ins.arg, child, nullptr))
+			{
+				ok = true;
+				break;
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	return ok;
+}
+
+bool CompiledSelector::runGroup(const Group &group, xmlNodePtr node, const MatchContext *context) const
+{
+	std::uint64_t order = group.order.load(std::memory_order_relaxed);
+	bool ok = true;
+
+	for (std::size_t i = 0; i < group.tests.size() && ok; i++)
+	{
+		std::size_t index = (order >> (4 * i)) & 15;
+		ok = test(group.tests[index], node, context);
+
+		const Counter &counter = group.counters[index];
+		counter.tested.fetch_add(1, std::memory_order_relaxed);
+		if (ok)
+		{
+			counter.passed.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	if ((group.runs.fetch_add(1, std::memory_order_relaxed) + 1) % AdaptInterval == 0)
+	{
+		reorder(group);
+	}
+	return ok;
+}
+
+void CompiledSelector::reorder(const Group &group) const
+{
+	std::vector<double> rank(group.tests.size());
+	for (std::size_t i = 0; i < rank.size(); i++)
+	{
+		// Expected cost per rejection: a test's cost over the chance it fails,
+		// smoothed so untried tests count as failing half the time.
+		double tested = static_cast<double>(group.counters[i].tested.load(std::memory_order_relaxed));
+		double passed = static_cast<double>(group.counters[i].passed.load(std::memory_order_relaxed));
+		rank[i] = testCost(group.tests[i].op) * (tested + 2) / (tested - passed + 1);
+	}
+
+	std::vector<std::size_t> indexes(rank.size());
+	for (std::size_t i = 0; i < indexes.size(); i++)
+	{
+		indexes[i] = i;
+	}
+	std::stable_sort(indexes.begin(), indexes.end(), [&rank](std::size_t a, std::size_t b)
+					 { return rank[a] < rank[b]; });
+
+	std::uint64_t order = 0;
+	for (std::size_t i = 0; i < indexes.size(); i++)
+	{
+		order |= static_cast<std::uint64_t>(indexes[i]) << (4 * i);
+	}
+	// Racing reorders each store a whole permutation; the last one wins.
+	group.order.store(order, std::memory_order_relaxed);
+}
+
+void CompiledSelector::adapt() const
+{
+	for (const Group &group : groups_)
+	{
+		reorder(group);
+	}
+}
+
+std::vector<std::vector<CompiledSelector::PredicateStats>> CompiledSelector::getStats() const
+{
+	std::vector<std::vector<PredicateStats>> stats;
+	for (const Group &group : groups_)
+	{
+		std::vector<PredicateStats> &tests = stats.emplace_back();
+		for (std::size_t i = 0; i < group.tests.size(); i++)
+		{
+			tests.push_back(PredicateStats{group.labels[i], group.counters[i].tested.load(std::memory_order_relaxed), group.counters[i].passed.load(std::memory_order_relaxed)});
+		}
+	}
+	return stats;
+}
+
+std::string CompiledSelector::exportStats() const
+{
+	std::stringstream ss;
+	ss << statsHeader << "\n"
+	   << toString() << "\n";
+
+	std::vector<std::vector<PredicateStats>> stats = getStats();
+	for (std::size_t g = 0; g < stats.size(); g++)
+	{
+		for (std::size_t i = 0; i < stats[g].size(); i++)
+		{
+			ss << g << "\t" << i << "\t" << stats[g][i].tested << "\t" << stats[g][i].passed << "\t" << stats[g][i].predicate << "\n";
+		}
+	}
+	return ss.str();
+}
+
+bool CompiledSelector::importStats(std::string_view stats)
+{
+	std::istringstream in{std::string(stats)};
+	std::string line;
+
+	if (!std::getline(in, line) || line != statsHeader || !std::getline(in, line) || line != toString())
+	{
+		return false;
+	}
+
+	struct Entry
+	{
+		std::size_t group, test;
+		std::uint64_t tested, passed;
+	};
+	std::vector<Entry> entries;
+
+	while (std::getline(in, line))
+	{
+		if (line.empty())
+		{
+			continue;
+		}
+
+		std::istringstream fields(line);
+		Entry entry{};
+		std::string predicate;
+		if (!(fields >> entry.group >> entry.test >> entry.tested >> entry.passed) || fields.get() != '\t')
+		{
+			return false;
+		}
+		std::getline(fields, predicate);
+
+		if (entry.group >= groups_.size() || entry.test >= groups_[entry.group].tests.size() || groups_[entry.group].labels[entry.test] != predicate || entry.passed > entry.tested)
+		{
+			return false;
+		}
+		entries.push_back(entry);
+	}
+
+	for (const Entry &entry : entries)
+	{
+		Counter &counter = groups_[entry.group].counters[entry.test];
+		counter.tested.store(entry.tested, std::memory_order_relaxed);
+		counter.passed.store(entry.passed, std::memory_order_relaxed);
+	}
+	adapt();
+	return true;
+}
+
+void CompiledSelector::collect(std::uint32_t program, xmlNodePtr scope, NodeSet &found) const
+{
+	std::vector<xmlNodePtr> stack;
+	stack.reserve(256);
+	stack.push_back(scope);
+
+	while (!stack.empty())
+	{
+		xmlNodePtr current = stack.back();
+		stack.pop_back();
+
+		if (run(program, current, nullptr))
+		{
+			found.push_back(current);
+		}
+
+		if (current->type == XML_ELEMENT_NODE)
+		{
+			for (xmlNodePtr child = current->last; child != nullptr; child = child->prev)
+			{
+				if (child->type == XML_ELEMENT_NODE)
+				{
+					stack.push_back(child);
+				}
+			}
+		}
+	}
+}
+
+std::string CompiledSelector::disassemble() const
+{
+	std::stringstream ss;
+
+	auto describe = [this, &ss](const Instruction &ins)
+	{
+		ss << opcodeName(ins.op);
+		switch (ins.op)
+		{
+		case Opcode::Tag:
+			ss << " " << names_[ins.arg]->str();
+			break;
+		case Opcode::Attribute:
+		case Opcode::Pseudo:
+		case Opcode::Text:
+		case Opcode::Call:
+			ss << " " << operands_[ins.arg]->toString();
+			break;
+		case Opcode::Sub:
+		case Opcode::Not:
+		case Opcode::Has:
+		case Opcode::HasChild:
+		case Opcode::Group:
+		case Opcode::Fork:
+			ss << " " << ins.arg;
+			break;
+		case Opcode::Filter:
+			ss << " " << keys_[ins.arg].size() << " keys";
+			break;
+		default:
+			break;
+		}
+		ss << "\n";
+	};
+
+	for (std::size_t p = 0; p < programs_.size(); p++)
+	{
+		ss << "program " << p << ":\n";
+		for (std::size_t pc = 0; pc < programs_[p].size(); pc++)
+		{
+			ss << "  " << pc << ": ";
+			describe(programs_[p][pc]);
+		}
+	}
+
+	// Groups are listed in their current order.
+	for (std::size_t g = 0; g < groups_.size(); g++)
+	{
+		std::uint64_t order = groups_[g].order.load(std::memory_order_relaxed);
+		ss << "group " << g << ":\n";
+		for (std::size_t i = 0; i < groups_[g].tests.size(); i++)
+		{
+			std::size_t index = (order >> (4 * i)) & 15;
+			ss << "  " << index << ": ";
+			describe(groups_[g].tests[index]);
+		}
+	}
+	return ss.str();
+}
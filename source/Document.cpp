@@ -1,4 +1,5 @@
 #include "Document.h"
+#include "SelectorCache.h"
 
 #include <stdexcept>
 
@@ -7,16 +8,7 @@ bool Document::parse(const std::string &input)
 	htmldoc_.reset(htmlReadFile(input.c_str(), "UTF-8",
 								HTML_PARSE_NOBLANKS | HTML_PARSE_COMPACT | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING | HTML_PARSE_NONET));
 
-	if (htmldoc_)
-	{
-		root_ = xmlDocGetRootElement(htmldoc_.get());
-		if (root_)
-		{
-			return true;
-		}
-		htmldoc_.reset();
-	}
-	return false;
+	return attach();
 }
 
 bool Document::parseMemory(const std::string &input)
@@ -24,11 +16,21 @@ bool Document::parseMemory(const std::string &input)
 	htmldoc_.reset(htmlReadMemory(input.c_str(), static_cast<int>(input.length()), nullptr, "UTF-8",
 								  HTML_PARSE_NOBLANKS | HTML_PARSE_COMPACT | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING | HTML_PARSE_NONET));
 
+	return attach();
+}
+
+bool Document::attach()
+{
+	index_.reset();
+	root_ = nullptr;
+
 	if (htmldoc_)
 	{
 		root_ = xmlDocGetRootElement(htmldoc_.get());
 		if (root_)
 		{
+			index_ = std::make_unique<DocumentIndex>(htmldoc_.get());
+			index_->Build();
 			return true;
 		}
 		htmldoc_.reset();
@@ -36,6 +38,21 @@ bool Document::parseMemory(const std::string &input)
 	return false;
 }
 
+void Document::Reindex()
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+
+	// The old index must leave the registry before its elements can be
+	// looked up again.
+	index_.reset();
+	root_ = xmlDocGetRootElement(htmldoc_.get());
+	index_ = std::make_unique<DocumentIndex>(htmldoc_.get());
+	index_->Build();
+}
+
 QueryResult Document::Find(std::string_view strsel) const
 {
 	if (!htmldoc_)
@@ -52,4 +69,181 @@ QueryResult Document::Find(const SelectorPtr &selector) const
 		throw std::runtime_error("Document not initialized");
 	}
 	return QueryResult::Find(root_, selector);
+}
+
+QueryResult Document::Find(std::string_view selector, std::size_t limit) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult::Find(root_, selector, limit);
+}
+
+QueryResult Document::Find(const SelectorPtr &selector, std::size_t limit) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult::Find(root_, selector, limit);
+}
+
+std::optional<Node> Document::FindFirst(std::string_view selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult(root_).FindFirst(selector);
+}
+
+std::optional<Node> Document::FindFirst(const SelectorPtr &selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult(root_).FindFirst(selector);
+}
+
+bool Document::Exists(std::string_view selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult(root_).Exists(selector);
+}
+
+bool Document::Exists(const SelectorPtr &selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult(root_).Exists(selector);
+}
+
+std::size_t Document::Count(std::string_view selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult(root_).Count(selector);
+}
+
+std::size_t Document::Count(const SelectorPtr &selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return QueryResult(root_).Count(selector);
+}
+
+void Document::ForEach(std::string_view selector, const std::function<bool(Node)> &visit) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	Node(root_).ForEach(selector, visit);
+}
+
+void Document::ForEach(const SelectorPtr &selector, const std::function<bool(Node)> &visit) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	Node(root_).ForEach(selector, visit);
+}
+
+MatchRange Document::Stream(std::string_view selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return Node(root_).Stream(selector);
+}
+
+MatchRange Document::Stream(const SelectorPtr &selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	return Node(root_).Stream(selector);
+}
+
+QueryResult Document::Find(std::string_view selector, const ParallelOptions &options) const
+{
+	return Find(SelectorCache::Global().get(selector), options);
+}
+
+QueryResult Document::Find(const SelectorPtr &selector, const ParallelOptions &options) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	if (options.threads == 1 || index_ == nullptr || index_->ElementCount() < options.threshold)
+	{
+		return QueryResult::Find(root_, selector);
+	}
+
+	NodeSet nodes;
+	if (index_->Find(root_, *selector, nodes))
+	{
+		return QueryResult(std::move(nodes));
+	}
+	return QueryResult(ParallelMatcher::MatchAll(*selector, root_, options.threads));
+}
+
+std::vector<QueryResult> Document::FindMany(const std::vector<std::string> &selectors) const
+{
+	std::vector<SelectorPtr> parsed;
+	parsed.reserve(selectors.size());
+	for (const std::string &selector : selectors)
+	{
+		parsed.push_back(SelectorCache::Global().get(selector));
+	}
+	return FindMany(parsed);
+}
+
+std::vector<QueryResult> Document::FindMany(const std::vector<SelectorPtr> &selectors) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+
+	std::vector<QueryResult> results;
+	results.reserve(selectors.size());
+	for (NodeSet &nodes : Selector::MatchMany(selectors, root_))
+	{
+		results.emplace_back(std::move(nodes));
+	}
+	return results;
+}
+
+QueryPlan Document::Explain(std::string_view selector) const
+{
+	return Explain(SelectorCache::Global().get(selector));
+}
+
+QueryPlan Document::Explain(const SelectorPtr &selector) const
+{
+	if (!htmldoc_)
+	{
+		throw std::runtime_error("Document not initialized");
+	}
+	if (index_ == nullptr)
+	{
+		return QueryPlan();
+	}
+	return index_->Plan(root_, *selector);
 }
\ No newline at end of file
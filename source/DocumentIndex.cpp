@@ -0,0 +1,820 @@
+#include "DocumentIndex.h"
+
+#include "AttributeSelector.h"
+#include "BinarySelector.h"
+#include "CompiledSelector.h"
+#include "NarySelector.h"
+#include "StructuralJoin.h"
+#include "TagSelector.h"
+#include "Helpers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <shared_mutex>
+
+namespace
+{
+	static const DocumentIndex::ElementList emptyList;
+	static const NameAtom *const idAtom = NameAtom::Intern("id");
+	static const NameAtom *const classAtom = NameAtom::Intern("class");
+
+	// Built indexes by document. Every change bumps the version, which
+	// invalidates the per-thread copies of the last answer.
+	struct Registry
+	{
+		std::shared_mutex mutex;
+		std::unordered_map<xmlDocPtr, const DocumentIndex *> indexes;
+		std::atomic<std::uint64_t> version{1};
+	};
+
+	struct LastLookup
+	{
+		xmlDocPtr doc = nullptr;
+		const DocumentIndex *index = nullptr;
+		std::uint64_t version = 0;
+	};
+
+	static Registry &registry()
+	{
+		// Never destroyed, so documents outliving static destruction can
+		// still unregister.
+		static Registry *instance = new Registry();
+		return *instance;
+	}
+
+	thread_local LastLookup lastLookup;
+
+	static inline std::size_t addressHash(xmlNodePtr node)
+	{
+		std::uint64_t hash = static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(node)) * 0x9E3779B97F4A7C15ull;
+		return static_cast<std::size_t>(hash ^ (hash >> 32));
+	}
+
+	static inline const Selector *unwrap(const Selector *selector)
+	{
+		if (const auto *compiled = dynamic_cast<const CompiledSelector *>(selector))
+		{
+			return compiled->getSource().get();
+		}
+		return selector;
+	}
+
+	using SubjectKeys = DocumentIndex::SubjectKeys;
+
+	static void collectSubjectKeys(const Selector *selector, SubjectKeys &keys)
+	{
+		selector = unwrap(selector);
+
+		if (const auto *attr = dynamic_cast<const AttributeSelector *>(selector))
+		{
+			if (attr->isCaseInsensitive() || attr->getValue().empty())
+			{
+				return;
+			}
+			if (attr->getOperator() == AttributeSelector::Operator::Equals && attr->getKey() == "id")
+			{
+				keys.id = &attr->getValue();
+			}
+			else if (attr->getOperator() == AttributeSelector::Operator::Includes && attr->getKey() == "class")
+			{
+				keys.classes.push_back(&attr->getValue());
+			}
+			return;
+		}
+
+		if (const auto *tag = dynamic_cast<const TagSelector *>(selector))
+		{
+			if (tag->getOperator() == TagSelector::Operator::Tag)
+			{
+				keys.tag = &tag->getRefValue();
+			}
+			return;
+		}
+
+		if (const auto *list = dynamic_cast<const NarySelector *>(selector))
+		{
+			if (list->getOperator() == NarySelector::Operator::Intersection)
+			{
+				for (const SelectorPtr &operand : list->getSelectors())
+				{
+					collectSubjectKeys(operand.get(), keys);
+				}
+			}
+			return;
+		}
+
+		const auto *binary = dynamic_cast<const BinarySelector *>(selector);
+		if (binary == nullptr)
+		{
+			return;
+		}
+
+		switch (binary->getOperator())
+		{
+		case BinarySelector::Operator::Intersection:
+			collectSubjectKeys(binary->getLeft().get(), keys);
+			collectSubjectKeys(binary->getRight().get(), keys);
+			break;
+		case BinarySelector::Operator::Child:
+		case BinarySelector::Operator::Descendant:
+		case BinarySelector::Operator::Adjacent:
+			collectSubjectKeys(binary->getRight().get(), keys);
+			break;
+		default:
+			break;
+		}
+	}
+
+	static inline const std::string *subjectId(const Selector *selector)
+	{
+		SubjectKeys keys;
+		collectSubjectKeys(selector, keys);
+		return keys.id;
+	}
+
+	// Id of an element every node matching selector must descend from, if any.
+	static const std::string *anchorId(const Selector *selector)
+	{
+		if (const auto *list = dynamic_cast<const NarySelector *>(unwrap(selector)))
+		{
+			if (list->getOperator() == NarySelector::Operator::Intersection)
+			{
+				for (const SelectorPtr &operand : list->getSelectors())
+				{
+					if (const std::string *id = anchorId(operand.get()))
+					{
+						return id;
+					}
+				}
+			}
+			return nullptr;
+		}
+
+		const auto *binary = dynamic_cast<const BinarySelector *>(unwrap(selector));
+		if (binary == nullptr)
+		{
+			return nullptr;
+		}
+
+		const std::string *id = nullptr;
+		switch (binary->getOperator())
+		{
+		case BinarySelector::Operator::Child:
+		case BinarySelector::Operator::Descendant:
+			id = subjectId(binary->getLeft().get());
+			if (id == nullptr)
+			{
+				id = anchorId(binary->getLeft().get());
+			}
+			return id != nullptr ? id : anchorId(binary->getRight().get());
+		case BinarySelector::Operator::Intersection:
+			id = anchorId(binary->getLeft().get());
+			return id != nullptr ? id : anchorId(binary->getRight().get());
+		case BinarySelector::Operator::Adjacent:
+			return anchorId(binary->getLeft().get());
+		default:
+			return nullptr;
+		}
+	}
+
+	// Ancestors or siblings a combinator is expected to visit when matched
+	// against one candidate at a time.
+	static constexpr std::size_t CombinatorCost = 4;
+
+	static std::size_t countCombinators(const Selector *selector)
+	{
+		selector = unwrap(selector);
+
+		if (const auto *list = dynamic_cast<const NarySelector *>(selector))
+		{
+			std::size_t count = 0;
+			for (const SelectorPtr &operand : list->getSelectors())
+			{
+				count += countCombinators(operand.get());
+			}
+			return count;
+		}
+
+		const auto *binary = dynamic_cast<const BinarySelector *>(selector);
+		if (binary == nullptr)
+		{
+			return 0;
+		}
+		std::size_t count = countCombinators(binary->getLeft().get()) + countCombinators(binary->getRight().get());
+		switch (binary->getOperator())
+		{
+		case BinarySelector::Operator::Child:
+		case BinarySelector::Operator::Descendant:
+		case BinarySelector::Operator::Adjacent:
+			return count + 1;
+		default:
+			return count;
+		}
+	}
+
+	// Branches of a selector group, or none when selector is not a group.
+	// Groups parse into a left-deep chain of unions, walked without recursing.
+	static std::vector<const Selector *> unionBranches(const Selector *selector)
+	{
+		selector = unwrap(selector);
+
+		std::vector<const Selector *> branches;
+		if (const auto *binary = dynamic_cast<const BinarySelector *>(selector); binary != nullptr && binary->getOperator() == BinarySelector::Operator::Union)
+		{
+			const Selector *left = selector;
+			while ((binary = dynamic_cast<const BinarySelector *>(left)) != nullptr && binary->getOperator() == BinarySelector::Operator::Union)
+			{
+				branches.push_back(binary->getRight().get());
+				left = binary->getLeft().get();
+			}
+			branches.push_back(left);
+			std::reverse(branches.begin(), branches.end());
+			return branches;
+		}
+
+		if (const auto *list = dynamic_cast<const NarySelector *>(selector); list != nullptr && list->getOperator() == NarySelector::Operator::Union)
+		{
+			for (const SelectorPtr &operand : list->getSelectors())
+			{
+				branches.push_back(operand.get());
+			}
+		}
+		return branches;
+	}
+} // namespace
+
+DocumentIndex::SubjectKeys DocumentIndex::GetSubjectKeys(const Selector &selector)
+{
+	SubjectKeys keys;
+	collectSubjectKeys(&selector, keys);
+	return keys;
+}
+
+DocumentIndex::~DocumentIndex()
+{
+	Registry &instance = registry();
+	std::unique_lock<std::shared_mutex> lock(instance.mutex);
+
+	auto it = instance.indexes.find(doc_);
+	if (it != instance.indexes.end() && it->second == this)
+	{
+		instance.indexes.erase(it);
+		instance.version++;
+	}
+}
+
+const DocumentIndex *DocumentIndex::FromNode(xmlNodePtr node)
+{
+	if (node == nullptr || node->doc == nullptr)
+	{
+		return nullptr;
+	}
+
+	Registry &instance = registry();
+	std::uint64_t version = instance.version.load(std::memory_order_acquire);
+	if (lastLookup.version != version || lastLookup.doc != node->doc)
+	{
+		std::shared_lock<std::shared_mutex> lock(instance.mutex);
+		auto it = instance.indexes.find(node->doc);
+		lastLookup = LastLookup{node->doc, it != instance.indexes.end() ? it->second : nullptr, version};
+	}
+	return lastLookup.index;
+}
+
+const ElementInfo *ElementInfo::Of(xmlNodePtr node)
+{
+	if (node->type != XML_ELEMENT_NODE)
+	{
+		return nullptr;
+	}
+	const DocumentIndex *index = DocumentIndex::FromNode(node);
+	return index != nullptr ? index->GetElementInfo(node) : nullptr;
+}
+
+std::pair<const ElementInfo *, const ElementInfo *> ElementInfo::Of(xmlNodePtr a, xmlNodePtr b)
+{
+	if (a->type != XML_ELEMENT_NODE || b->type != XML_ELEMENT_NODE || a->doc != b->doc)
+	{
+		return {nullptr, nullptr};
+	}
+	const DocumentIndex *index = DocumentIndex::FromNode(a);
+	const ElementInfo *infoA = index != nullptr ? index->GetElementInfo(a) : nullptr;
+	const ElementInfo *infoB = infoA != nullptr ? index->GetElementInfo(b) : nullptr;
+	return infoB != nullptr ? std::make_pair(infoA, infoB) : std::make_pair(nullptr, nullptr);
+}
+
+const ElementInfo *DocumentIndex::GetElementInfo(xmlNodePtr element) const
+{
+	Build();
+	return infoOf(element);
+}
+
+ElementInfo *DocumentIndex::infoOf(xmlNodePtr element) const
+{
+	if (infos_.empty())
+	{
+		return nullptr;
+	}
+
+	std::size_t mask = infos_.size() - 1;
+	for (std::size_t i = addressHash(element) & mask;; i = (i + 1) & mask)
+	{
+		if (infos_[i].first == element)
+		{
+			return infos_[i].second;
+		}
+		if (infos_[i].first == nullptr)
+		{
+			return nullptr;
+		}
+	}
+}
+
+void DocumentIndex::insertInfo(xmlNodePtr element, ElementInfo *info) const
+{
+	if (elements_.size() * 2 > infos_.size())
+	{
+		std::vector<std::pair<xmlNodePtr, ElementInfo *>> old(std::max<std::size_t>(64, infos_.size() * 2));
+		old.swap(infos_);
+		for (const auto &entry : old)
+		{
+			if (entry.first != nullptr)
+			{
+				insertInfo(entry.first, entry.second);
+			}
+		}
+	}
+
+	std::size_t mask = infos_.size() - 1;
+	std::size_t i = addressHash(element) & mask;
+	while (infos_[i].first != nullptr)
+	{
+		i = (i + 1) & mask;
+	}
+	infos_[i] = std::make_pair(element, info);
+}
+
+void DocumentIndex::Build() const
+{
+	std::call_once(buildOnce_, [this]()
+				   { build(); });
+}
+
+struct DocumentIndex::BuildState
+{
+	struct Name
+	{
+		const NameAtom *atom;
+		// Posting list of the lowercased name, which also identifies it.
+		ElementList *tagged;
+	};
+
+	explicit BuildState(std::unordered_map<std::string, ElementList> &tags) : tags(tags) {}
+
+	std::unordered_map<std::string, ElementList> &tags;
+	// Names by the address of their spelling; the parser keeps a single copy
+	// of each spelling in the document's dictionary.
+	std::unordered_map<const xmlChar *, Name> names;
+	// Children of the current parent so far by name, and the name of each.
+	std::unordered_map<const ElementList *, std::uint32_t> types;
+	std::vector<const ElementList *> kinds;
+
+	const Name &nameOf(const xmlChar *name)
+	{
+		auto it = names.find(name);
+		if (it == names.end())
+		{
+			std::string lower(reinterpret_cast<const char *>(name));
+			for (char &c : lower)
+			{
+				c = (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+			}
+			// Looked up, never interned: the document's names must not grow
+			// the process-wide table.
+			it = names.emplace(name, Name{NameAtom::Find(lower), &tags[lower]}).first;
+		}
+		return it->second;
+	}
+};
+
+void DocumentIndex::stampChildren(xmlNodePtr parent, BuildState &state) const
+{
+	std::uint32_t count = 0;
+	state.types.clear();
+	state.kinds.clear();
+
+	for (xmlNodePtr child = parent->children; child != nullptr; child = child->next)
+	{
+		if (child->type != XML_ELEMENT_NODE)
+		{
+			continue;
+		}
+
+		ElementInfo &info = elements_.emplace_back();
+		info.position = ++count;
+		const ElementList *kind = nullptr;
+		if (child->name != nullptr)
+		{
+			const BuildState::Name &name = state.nameOf(child->name);
+			info.name = name.atom;
+			kind = name.tagged;
+			info.typePosition = ++state.types[kind];
+		}
+		state.kinds.push_back(kind);
+		insertInfo(child, &info);
+	}
+
+	// The children's infos are the last ones added.
+	auto kind = state.kinds.begin();
+	for (auto it = elements_.end() - count; it != elements_.end(); ++it, ++kind)
+	{
+		it->siblings = count;
+		it->typeSiblings = *kind != nullptr ? state.types[*kind] : 0;
+	}
+}
+
+void DocumentIndex::build() const
+{
+	std::vector<xmlNodePtr> stack;
+	stack.reserve(256);
+
+	BuildState state(tags_);
+	stampChildren(reinterpret_cast<xmlNodePtr>(doc_), state);
+
+	for (xmlNodePtr child = xmlGetLastChild(reinterpret_cast<xmlNodePtr>(doc_)); child != nullptr; child = child->prev)
+	{
+		if (child->type == XML_ELEMENT_NODE)
+		{
+			stack.push_back(child);
+		}
+	}
+
+	// Elements are popped in document order.
+	ordered_.reserve(elements_.size());
+	std::vector<ElementInfo *> infos;
+	infos.reserve(elements_.size());
+
+	while (!stack.empty())
+	{
+		xmlNodePtr current = stack.back();
+		stack.pop_back();
+		ElementInfo *element = infoOf(current);
+		element->order = static_cast<std::uint32_t>(ordered_.size());
+		ordered_.push_back(current);
+		infos.push_back(element);
+
+		stampChildren(current, state);
+
+		if (current->name != nullptr)
+		{
+			state.nameOf(current->name).tagged->push_back(current);
+		}
+
+		bool seenId = false;
+		bool seenClass = false;
+
+		for (xmlAttrPtr attr = current->properties; attr != nullptr && !(seenId && seenClass); attr = attr->next)
+		{
+			if (attr->name == nullptr)
+			{
+				continue;
+			}
+			if (!seenId && idAtom->Matches(attr))
+			{
+				seenId = true;
+				ids_[GetPropNodeValue(doc_, attr->children)].push_back(current);
+			}
+			else if (!seenClass && classAtom->Matches(attr))
+			{
+				seenClass = true;
+				std::string value = GetPropNodeValue(doc_, attr->children);
+				std::size_t start = 0;
+
+				while (start < value.length())
+				{
+					while (start < value.length() && std::isspace(static_cast<unsigned char>(value[start])))
+					{
+						start++;
+					}
+					std::size_t end = start;
+					while (end < value.length() && !std::isspace(static_cast<unsigned char>(value[end])))
+					{
+						end++;
+					}
+					if (end > start)
+					{
+						ElementList &list = classes_[value.substr(start, end - start)];
+						// A token repeated within one attribute lists the element once.
+						if (list.empty() || list.back() != current)
+						{
+							list.push_back(current);
+						}
+					}
+					start = end;
+				}
+			}
+		}
+
+		for (xmlNodePtr child = current->last; child != nullptr; child = child->prev)
+		{
+			if (child->type == XML_ELEMENT_NODE)
+			{
+				stack.push_back(child);
+			}
+		}
+	}
+
+	// Children follow their parent in preorder, so a reverse pass sees every
+	// subtree complete before adding it to its parent.
+	for (std::size_t i = ordered_.size(); i-- > 0;)
+	{
+		ElementInfo *info = infos[i];
+		info->subtreeSize++;
+		xmlNodePtr parent = ordered_[i]->parent;
+		if (parent != nullptr && parent->type == XML_ELEMENT_NODE)
+		{
+			infoOf(parent)->subtreeSize += info->subtreeSize;
+		}
+	}
+
+	Registry &instance = registry();
+	std::unique_lock<std::shared_mutex> lock(instance.mutex);
+	instance.indexes[doc_] = this;
+	instance.version++;
+}
+
+const DocumentIndex::ElementList &DocumentIndex::lookup(const std::unordered_map<std::string, ElementList> &map, const std::string &key) const
+{
+	Build();
+
+	auto it = map.find(key);
+	return it != map.end() ? it->second : emptyList;
+}
+
+const DocumentIndex::ElementList &DocumentIndex::GetElementsById(const std::string &id) const
+{
+	return lookup(ids_, id);
+}
+
+const DocumentIndex::ElementList &DocumentIndex::GetElementsByTagName(const std::string &name) const
+{
+	return lookup(tags_, name);
+}
+
+const DocumentIndex::ElementList &DocumentIndex::GetElementsByClassName(const std::string &name) const
+{
+	return lookup(classes_, name);
+}
+
+std::size_t DocumentIndex::ElementCount() const
+{
+	Build();
+	return elements_.size();
+}
+
+const DocumentIndex::ElementList &DocumentIndex::GetElements() const
+{
+	Build();
+	return ordered_;
+}
+
+std::size_t DocumentIndex::SubtreeSize(xmlNodePtr node) const
+{
+	const ElementInfo *info = GetElementInfo(node);
+	return info != nullptr ? info->subtreeSize : elements_.size();
+}
+
+QueryPlan DocumentIndex::Plan(xmlNodePtr scope, const Selector &selector) const
+{
+	using Strategy = QueryPlan::Strategy;
+
+	QueryPlan plan;
+	if (scope == nullptr || scope->doc != doc_)
+	{
+		return plan;
+	}
+
+	// Testing the whole selector on an element also walks its combinators.
+	std::size_t perElement = 1 + CombinatorCost * countCombinators(&selector);
+
+	plan.scanCost = SubtreeSize(scope) * perElement;
+	plan.cost = plan.scanCost;
+	plan.considered.push_back(QueryPlan::Option{Strategy::Scan, std::string(), plan.scanCost});
+
+	auto consider = [&plan](Strategy strategy, const std::string &key, std::size_t cost)
+	{
+		plan.considered.push_back(QueryPlan::Option{strategy, key, cost});
+		if (cost < plan.cost)
+		{
+			plan.strategy = strategy;
+			plan.key = key;
+			plan.cost = cost;
+		}
+	};
+
+	std::vector<const Selector *> branches = unionBranches(&selector);
+	if (!branches.empty())
+	{
+		std::vector<QueryPlan> plans;
+		std::size_t cost = 0;
+		for (const Selector *branch : branches)
+		{
+			plans.push_back(Plan(scope, *branch));
+			cost += plans.back().cost;
+		}
+		consider(Strategy::Union, std::string(), cost);
+		if (plan.strategy == Strategy::Union)
+		{
+			plan.branches = std::move(plans);
+		}
+		return plan;
+	}
+
+	SubjectKeys keys = GetSubjectKeys(selector);
+
+	if (keys.id != nullptr)
+	{
+		consider(Strategy::IdSeed, *keys.id, GetElementsById(*keys.id).size() * perElement);
+	}
+	if (keys.tag != nullptr)
+	{
+		consider(Strategy::TagSeed, *keys.tag, GetElementsByTagName(*keys.tag).size() * perElement);
+	}
+	for (const std::string *name : keys.classes)
+	{
+		consider(Strategy::ClassSeed, *name, GetElementsByClassName(*name).size() * perElement);
+	}
+
+	if (const std::string *id = anchorId(&selector))
+	{
+		const ElementList &anchors = GetElementsById(*id);
+
+		// A scope already inside an anchor leaves nothing to narrow.
+		if (std::none_of(anchors.begin(), anchors.end(), [scope](xmlNodePtr anchor)
+						 { return ElementInfo::IsInclusiveAncestor(anchor, scope); }))
+		{
+			std::size_t cost = 0;
+			for (xmlNodePtr anchor : anchors)
+			{
+				if (ElementInfo::IsInclusiveAncestor(scope, anchor))
+				{
+					cost += SubtreeSize(anchor) * perElement;
+				}
+			}
+			consider(Strategy::ScopedDescent, *id, cost);
+		}
+	}
+
+	// A join tests each candidate against its own compound only.
+	std::vector<StructuralJoin::Step> steps;
+	if (StructuralJoin::Decompose(selector, steps))
+	{
+		std::size_t cost = 0;
+		for (const StructuralJoin::Step &step : steps)
+		{
+			cost += candidates(*step.compound).size();
+		}
+		consider(Strategy::StructuralJoin, std::string(), cost);
+	}
+	return plan;
+}
+
+const DocumentIndex::ElementList &DocumentIndex::candidates(const Selector &compound) const
+{
+	SubjectKeys keys = GetSubjectKeys(compound);
+
+	if (keys.id != nullptr)
+	{
+		return GetElementsById(*keys.id);
+	}
+	const ElementList *smallest = keys.tag != nullptr ? &GetElementsByTagName(*keys.tag) : &GetElements();
+	for (const std::string *name : keys.classes)
+	{
+		const ElementList &list = GetElementsByClassName(*name);
+		if (list.size() < smallest->size())
+		{
+			smallest = &list;
+		}
+	}
+	return *smallest;
+}
+
+bool DocumentIndex::Find(xmlNodePtr scope, const Selector &selector, NodeSet &result, std::size_t limit) const
+{
+	if (scope == nullptr || scope->doc != doc_)
+	{
+		return false;
+	}
+	if (limit == 0)
+	{
+		return true;
+	}
+
+	QueryPlan plan = Plan(scope, selector);
+	if (plan.strategy == QueryPlan::Strategy::Scan)
+	{
+		return false;
+	}
+	execute(plan, scope, selector, result, limit);
+	return true;
+}
+
+void DocumentIndex::execute(const QueryPlan &plan, xmlNodePtr scope, const Selector &selector, NodeSet &result, std::size_t limit) const
+{
+	using Strategy = QueryPlan::Strategy;
+
+	bool whole = scope == xmlDocGetRootElement(doc_);
+	auto seed = [&](const ElementList &candidates)
+	{
+		for (xmlNodePtr candidate : candidates)
+		{
+			if ((whole || ElementInfo::IsInclusiveAncestor(scope, candidate)) && selector.matches(candidate))
+			{
+				result.push_back(candidate);
+				if (result.size() == limit)
+				{
+					break;
+				}
+			}
+		}
+	};
+
+	switch (plan.strategy)
+	{
+	case Strategy::IdSeed:
+		seed(GetElementsById(plan.key));
+		break;
+	case Strategy::TagSeed:
+		seed(GetElementsByTagName(plan.key));
+		break;
+	case Strategy::ClassSeed:
+		seed(GetElementsByClassName(plan.key));
+		break;
+	case Strategy::ScopedDescent:
+		for (xmlNodePtr anchor : GetElementsById(plan.key))
+		{
+			if (ElementInfo::IsInclusiveAncestor(scope, anchor))
+			{
+				result.merge(selector.MatchAll(anchor, limit));
+			}
+		}
+		result.truncate(limit);
+		break;
+	case Strategy::StructuralJoin:
+	{
+		std::vector<StructuralJoin::Step> steps;
+		StructuralJoin::Decompose(selector, steps);
+
+		auto select = [&](const StructuralJoin::Step &step, bool inScope)
+		{
+			ElementList selected;
+			for (xmlNodePtr candidate : candidates(*step.compound))
+			{
+				if ((!inScope || ElementInfo::IsInclusiveAncestor(scope, candidate)) && step.compound->matches(candidate))
+				{
+					selected.push_back(candidate);
+				}
+			}
+			return selected;
+		};
+
+		// Left-hand compounds may match outside the scope; only the subject
+		// must lie within it.
+		ElementList matched = select(steps.front(), false);
+		// A compound matching the document node makes every element a
+		// descendant of a match, as BinarySelector finds walking ancestors.
+		bool rooted = steps[1].combinator == BinarySelector::Operator::Descendant && steps.front().compound->matches(reinterpret_cast<xmlNodePtr>(doc_));
+		for (std::size_t i = 1; i < steps.size() && (rooted || !matched.empty()); i++)
+		{
+			ElementList right = select(steps[i], i + 1 == steps.size());
+			matched = i == 1 && rooted ? std::move(right) : StructuralJoin::Join(*this, matched, right, steps[i].combinator, steps[i].adjacent);
+		}
+		for (xmlNodePtr node : matched)
+		{
+			result.push_back(node);
+			if (result.size() == limit)
+			{
+				break;
+			}
+		}
+		break;
+	}
+	case Strategy::Union:
+	{
+		std::vector<const Selector *> branches = unionBranches(&selector);
+		NodeSet found;
+		for (std::size_t i = 0; i < branches.size(); i++)
+		{
+			NodeSet branch;
+			execute(plan.branches[i], scope, *branches[i], branch, limit);
+			found.merge(branch);
+		}
+		found.truncate(limit);
+		result.merge(found);
+		break;
+	}
+	default:
+		result.merge(selector.MatchAll(scope, limit));
+		break;
+	}
+}
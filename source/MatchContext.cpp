@@ -0,0 +1,420 @@
+#include "MatchContext.h"
+#include "Helpers.h"
+
+#include <algorithm>
+
+namespace
+{
+	static const NameAtom *const idAtom = NameAtom::Intern("id");
+	static const NameAtom *const classAtom = NameAtom::Intern("class");
+
+	enum : std::uint32_t
+	{
+		TagSeed = 2166136261u,
+		IdSeed = 0x811c9dc5u ^ 0x9e3779b9u,
+		ClassSeed = 0x811c9dc5u ^ 0x85ebca6bu,
+	};
+
+	static inline std::uint32_t foldedHash(std::string_view value, std::uint32_t seed)
+	{
+		std::uint32_t hash = seed;
+		for (char c : value)
+		{
+			hash ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(c)));
+			hash *= 16777619u;
+		}
+		// Final avalanche so both 12-bit probes depend on every input byte.
+		hash ^= hash >> 16;
+		hash *= 0x7feb352du;
+		hash ^= hash >> 15;
+		return hash;
+	}
+
+	static inline void collectClassKeys(std::string_view value, std::vector<std::uint32_t> &keys)
+	{
+		std::size_t start = 0;
+		while (start < value.length())
+		{
+			while (start < value.length() && std::isspace(static_cast<unsigned char>(value[start])))
+			{
+				start++;
+			}
+			std::size_t end = start;
+			while (end < value.length() && !std::isspace(static_cast<unsigned char>(value[end])))
+			{
+				end++;
+			}
+			if (end > start)
+			{
+				keys.push_back(AncestorFilter::ClassKey(value.substr(start, end - start)));
+			}
+			start = end;
+		}
+	}
+} // namespace
+
+std::uint32_t AncestorFilter::TagKey(std::string_view name)
+{
+	return foldedHash(name, TagSeed);
+}
+
+std::uint32_t AncestorFilter::IdKey(std::string_view id)
+{
+	return foldedHash(id, IdSeed);
+}
+
+std::uint32_t AncestorFilter::ClassKey(std::string_view name)
+{
+	return foldedHash(name, ClassSeed);
+}
+
+void AncestorFilter::CollectKeys(xmlNodePtr element, std::vector<std::uint32_t> &keys)
+{
+	if (element == nullptr || element->type != XML_ELEMENT_NODE || element->name == nullptr)
+	{
+		return;
+	}
+
+	const NameAtom *name = NameAtom::Of(element);
+	keys.push_back(name != nullptr ? name->tagKey() : TagKey(reinterpret_cast<const char *>(element->name)));
+
+	for (xmlAttrPtr attr = element->properties; attr != nullptr; attr = attr->next)
+	{
+		if (attr->name == nullptr || attr->children == nullptr)
+		{
+			continue;
+		}
+
+		bool isId = idAtom->Matches(attr);
+		bool isClass = !isId && classAtom->Matches(attr);
+
+		if (!isId && !isClass)
+		{
+			continue;
+		}
+
+		std::string owned;
+		std::string_view value;
+		xmlNodePtr text = attr->children;
+
+		if (text->type == XML_TEXT_NODE && text->next == nullptr && text->content != nullptr)
+		{
+			value = reinterpret_cast<const char *>(text->content);
+		}
+		else
+		{
+			owned = GetPropNodeValue(element->doc, text);
+			value = owned;
+		}
+
+		if (isId)
+		{
+			keys.push_back(IdKey(value));
+		}
+		else
+		{
+			collectClassKeys(value, keys);
+		}
+	}
+}
+
+void AncestorFilter::push(xmlNodePtr element)
+{
+	std::size_t begin = keys_.size();
+	frames_.push_back(begin);
+	CollectKeys(element, keys_);
+
+	for (std::size_t i = begin; i < keys_.size(); i++)
+	{
+		add(keys_[i]);
+	}
+}
+
+void AncestorFilter::pop()
+{
+	if (frames_.empty())
+	{
+		return;
+	}
+
+	std::size_t begin = frames_.back();
+	frames_.pop_back();
+
+	for (std::size_t i = begin; i < keys_.size(); i++)
+	{
+		remove(keys_[i]);
+	}
+	keys_.resize(begin);
+}
+
+void AncestorFilter::clear()
+{
+	counters_.fill(0);
+	keys_.clear();
+	frames_.clear();
+}
+
+void AncestorFilter::add(std::uint32_t key)
+{
+	std::uint8_t &first = counters_[key & kMask];
+	std::uint8_t &second = counters_[(key >> kBits) & kMask];
+
+	// Saturated counters stick, so a later remove can never produce a false negative.
+	if (first != UINT8_MAX)
+	{
+		first++;
+	}
+	if (second != UINT8_MAX)
+	{
+		second++;
+	}
+}
+
+void AncestorFilter::remove(std::uint32_t key)
+{
+	std::uint8_t &first = counters_[key & kMask];
+	std::uint8_t &second = counters_[(key >> kBits) & kMask];
+
+	if (first != UINT8_MAX)
+	{
+		first--;
+	}
+	if (second != UINT8_MAX)
+	{
+		second--;
+	}
+}
+
+void InheritedState::start(xmlNodePtr node)
+{
+	active_ = true;
+	langs_.clear();
+	frames_.clear();
+
+	std::vector<xmlNodePtr> ancestors;
+	for (xmlNodePtr parent = node->parent; parent != nullptr; parent = parent->parent)
+	{
+		ancestors.push_back(parent);
+	}
+	for (auto it = ancestors.rbegin(); it != ancestors.rend(); ++it)
+	{
+		push(*it);
+	}
+}
+
+void InheritedState::push(xmlNodePtr element)
+{
+	frames_.push_back(langs_.size());
+	if (element->type == XML_ELEMENT_NODE && xmlHasProp(element, reinterpret_cast<const xmlChar *>("lang")) != nullptr)
+	{
+		langs_.push_back(GetAttributeValue(element, "lang").value_or(""));
+	}
+}
+
+void InheritedState::pop()
+{
+	if (frames_.empty())
+	{
+		return;
+	}
+	langs_.resize(frames_.back());
+	frames_.pop_back();
+}
+
+void MatchMemo::reset()
+{
+	used_ = 0;
+	if (slots_.size() > kRetainedSlots)
+	{
+		std::vector<Slot>().swap(slots_);
+	}
+	if (++epoch_ == 0)
+	{
+		// After a wrap, stale stamps could pass for current ones.
+		std::fill(slots_.begin(), slots_.end(), Slot());
+		epoch_ = 1;
+	}
+}
+
+std::size_t MatchMemo::slotOf(const void *key, xmlNodePtr node) const
+{
+	std::uint64_t hash = reinterpret_cast<std::uintptr_t>(key) * 0x9e3779b97f4a7c15ull ^ reinterpret_cast<std::uintptr_t>(node);
+	hash ^= hash >> 29;
+	hash *= 0xbf58476d1ce4e5b9ull;
+	hash ^= hash >> 32;
+	return static_cast<std::size_t>(hash) & (slots_.size() - 1);
+}
+
+int MatchMemo::find(const void *key, xmlNodePtr node) const
+{
+	if (used_ == 0)
+	{
+		return -1;
+	}
+	for (std::size_t i = slotOf(key, node);; i = (i + 1) & (slots_.size() - 1))
+	{
+		const Slot &slot = slots_[i];
+		if (slot.epoch != epoch_)
+		{
+			return -1;
+		}
+		if (slot.key == key && slot.node == node)
+		{
+			return slot.result ? 1 : 0;
+		}
+	}
+}
+
+void MatchMemo::insert(const void *key, xmlNodePtr node, bool result)
+{
+	// Kept at most half full, so probes stay short and always end.
+	if ((used_ + 1) * 2 > slots_.size())
+	{
+		grow();
+	}
+	for (std::size_t i = slotOf(key, node);; i = (i + 1) & (slots_.size() - 1))
+	{
+		Slot &slot = slots_[i];
+		if (slot.epoch != epoch_)
+		{
+			slot = Slot{key, node, epoch_, result};
+			used_++;
+			return;
+		}
+		if (slot.key == key && slot.node == node)
+		{
+			slot.result = result;
+			return;
+		}
+	}
+}
+
+void MatchMemo::grow()
+{
+	std::vector<Slot> old;
+	old.swap(slots_);
+	slots_.assign(old.empty() ? 64 : old.size() * 2, Slot());
+	std::uint32_t epoch = epoch_;
+	used_ = 0;
+
+	for (const Slot &slot : old)
+	{
+		if (slot.epoch == epoch)
+		{
+			insert(slot.key, slot.node, slot.result);
+		}
+	}
+}
+
+bool MatchContext::covers(xmlNodePtr node) const
+{
+	if (scope == nullptr || node == nullptr)
+	{
+		return false;
+	}
+
+	xmlNodePtr top = scope->parent != nullptr ? scope->parent : scope;
+	if (top->type == XML_DOCUMENT_NODE || top->type == XML_HTML_DOCUMENT_NODE)
+	{
+		return node->doc == scope->doc;
+	}
+
+	for (; node != nullptr; node = node->parent)
+	{
+		if (node == scope)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+const MatchContext::Marks &MatchContext::hasMarks(const void *key, const Collector &collect) const
+{
+	auto it = has_.find(key);
+	if (it != has_.end())
+	{
+		return it->second;
+	}
+
+	NodeSet found;
+	collect(scope, found);
+
+	Marks &marks = has_[key];
+	for (xmlNodePtr node : found)
+	{
+		if (node->type != XML_ELEMENT_NODE)
+		{
+			continue;
+		}
+		for (xmlNodePtr parent = node->parent; parent != nullptr && parent->type == XML_ELEMENT_NODE; parent = parent->parent)
+		{
+			// Ancestors above an element already marked are marked too.
+			if (!marks.insert(parent).second)
+			{
+				break;
+			}
+		}
+	}
+	return marks;
+}
+
+bool MatchContext::precededBy(const void *key, xmlNodePtr node, const Test &test) const
+{
+	Siblings &last = siblings_[key][node->parent];
+	if (last.node == node)
+	{
+		return last.preceded;
+	}
+
+	// Walking back reaches the last node asked about unless node comes
+	// before it, in which case the walk is a plain full one.
+	bool preceded = false;
+	for (xmlNodePtr sibling = node->prev; sibling != nullptr; sibling = sibling->prev)
+	{
+		if (sibling->type != XML_ELEMENT_NODE)
+		{
+			continue;
+		}
+		if (sibling == last.node)
+		{
+			preceded = last.preceded || test(sibling);
+			break;
+		}
+		if (test(sibling))
+		{
+			preceded = true;
+			break;
+		}
+	}
+
+	last.node = node;
+	last.preceded = preceded;
+	return preceded;
+}
+
+bool MatchContext::langMatches(std::string_view lang) const
+{
+	if (!inherited.active())
+	{
+		inherited.start(current);
+	}
+
+	auto matches = [lang](std::string_view value)
+	{
+		return value.substr(0, lang.length()) == lang && (value.length() == lang.length() || value[lang.length()] == '-');
+	};
+
+	if (xmlHasProp(current, reinterpret_cast<const xmlChar *>("lang")) != nullptr && matches(GetAttributeValue(current, "lang").value_or("")))
+	{
+		return true;
+	}
+	for (const std::string &value : inherited.langs())
+	{
+		if (matches(value))
+		{
+			return true;
+		}
+	}
+	return false;
+}
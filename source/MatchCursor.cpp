@@ -0,0 +1,128 @@
+#include "MatchCursor.h"
+
+namespace
+{
+	static inline xmlNodePtr firstElement(xmlNodePtr node)
+	{
+		while (node != nullptr && node->type != XML_ELEMENT_NODE)
+		{
+			node = node->next;
+		}
+		return node;
+	}
+
+	static inline MatchContext contextFor(const Selector &selector)
+	{
+		MatchContext context;
+		context.useAncestorFilter = selector.usesAncestorFilter();
+		return context;
+	}
+} // namespace
+
+SubtreeWalk::SubtreeWalk(xmlNodePtr scope, MatchContext &context) : context_(context), root_(scope)
+{
+	context_.scope = scope;
+	context_.memo = &memo_;
+	enter(scope);
+}
+
+void SubtreeWalk::restart(xmlNodePtr root)
+{
+	root_ = root;
+	current_ = nullptr;
+	started_ = false;
+	descend_ = true;
+
+	context_.ancestors.clear();
+	enter(root);
+	if (context_.inherited.active() && root != nullptr)
+	{
+		context_.inherited.start(root);
+	}
+}
+
+void SubtreeWalk::enter(xmlNodePtr root)
+{
+	if (context_.useAncestorFilter && root != nullptr)
+	{
+		for (xmlNodePtr parent = root->parent; parent != nullptr; parent = parent->parent)
+		{
+			context_.ancestors.push(parent);
+		}
+	}
+}
+
+xmlNodePtr SubtreeWalk::next()
+{
+	if (!started_)
+	{
+		started_ = true;
+		current_ = root_;
+	}
+	else if (current_ != nullptr)
+	{
+		current_ = advance(current_);
+	}
+	descend_ = true;
+	context_.current = current_;
+	return current_;
+}
+
+xmlNodePtr SubtreeWalk::advance(xmlNodePtr node)
+{
+	// Only elements are descended into; the ancestor filter holds every
+	// element between the scope and the next node.
+	if (node->type == XML_ELEMENT_NODE && descend_)
+	{
+		if (xmlNodePtr child = firstElement(node->children))
+		{
+			if (context_.useAncestorFilter)
+			{
+				context_.ancestors.push(node);
+			}
+			if (context_.inherited.active())
+			{
+				context_.inherited.push(node);
+			}
+			return child;
+		}
+	}
+
+	while (node != root_)
+	{
+		if (xmlNodePtr sibling = firstElement(node->next))
+		{
+			return sibling;
+		}
+		node = node->parent;
+		if (node == root_ || node == nullptr)
+		{
+			break;
+		}
+		if (context_.useAncestorFilter)
+		{
+			context_.ancestors.pop();
+		}
+		if (context_.inherited.active())
+		{
+			context_.inherited.pop();
+		}
+	}
+	return nullptr;
+}
+
+MatchCursor::MatchCursor(const Selector &selector, xmlNodePtr scope) : selector_(selector), context_(contextFor(selector)), walk_(scope, context_)
+{
+}
+
+xmlNodePtr MatchCursor::next()
+{
+	while (xmlNodePtr node = walk_.next())
+	{
+		if (selector_.matches(node, context_))
+		{
+			return node;
+		}
+	}
+	return nullptr;
+}
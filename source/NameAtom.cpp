@@ -0,0 +1,162 @@
+#include "NameAtom.h"
+#include "MatchContext.h"
+
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace
+{
+	static inline char asciiLower(char c)
+	{
+		return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+	}
+
+	struct FoldedHash
+	{
+		std::size_t operator()(std::string_view name) const
+		{
+			std::size_t hash = 14695981039346656037ull;
+			for (char c : name)
+			{
+				hash ^= static_cast<unsigned char>(asciiLower(c));
+				hash *= 1099511628211ull;
+			}
+			return hash;
+		}
+	};
+
+	struct FoldedEqual
+	{
+		bool operator()(std::string_view a, std::string_view b) const
+		{
+			if (a.length() != b.length())
+			{
+				return false;
+			}
+			for (std::size_t i = 0; i < a.length(); i++)
+			{
+				if (asciiLower(a[i]) != asciiLower(b[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+	};
+
+	// Keys view the name owned by their atom.
+	using AtomTable = std::unordered_map<std::string_view, std::unique_ptr<NameAtom>, FoldedHash, FoldedEqual>;
+
+	static const char *const htmlNames[] = {
+		"a", "abbr", "acronym", "address", "applet", "area", "article", "aside", "audio", "b", "base", "basefont", "bdi", "bdo", "big",
+		"blockquote", "body", "br", "button", "canvas", "caption", "center", "cite", "code", "col", "colgroup", "data", "datalist", "dd",
+		"del", "details", "dfn", "dialog", "dir", "div", "dl", "dt", "em", "embed", "fieldset", "figcaption", "figure", "font", "footer",
+		"form", "frame", "frameset", "h1", "h2", "h3", "h4", "h5", "h6", "head", "header", "hgroup", "hr", "html", "i", "iframe", "img",
+		"input", "ins", "kbd", "label", "legend", "li", "link", "main", "map", "mark", "menu", "menuitem", "meta", "meter", "nav",
+		"noframes", "noscript", "object", "ol", "optgroup", "option", "output", "p", "param", "picture", "pre", "progress", "q", "rp",
+		"rt", "ruby", "s", "samp", "script", "search", "section", "select", "slot", "small", "source", "span", "strike", "strong",
+		"style", "sub", "summary", "sup", "svg", "table", "tbody", "td", "template", "textarea", "tfoot", "th", "thead", "time", "title",
+		"tr", "track", "tt", "u", "ul", "var", "video", "wbr"};
+
+} // namespace
+
+struct NameAtom::Table
+{
+	// Readers only share the lock, so concurrent document loads do not wait
+	// on one another.
+	std::shared_mutex mutex;
+	AtomTable atoms;
+};
+
+NameAtom::NameAtom(std::string name) : name_(std::move(name)), tagKey_(AncestorFilter::TagKey(name_)) {}
+
+NameAtom::Table &NameAtom::table()
+{
+	static Table *instance = []()
+	{
+		auto *created = new Table();
+		for (const char *name : htmlNames)
+		{
+			std::unique_ptr<NameAtom> atom(new NameAtom(name));
+			std::string_view key = atom->str();
+			created->atoms.emplace(key, std::move(atom));
+		}
+		return created;
+	}();
+	return *instance;
+}
+
+const NameAtom *NameAtom::Find(std::string_view name)
+{
+	Table &instance = table();
+	std::shared_lock<std::shared_mutex> lock(instance.mutex);
+
+	auto it = instance.atoms.find(name);
+	return it != instance.atoms.end() ? it->second.get() : nullptr;
+}
+
+const NameAtom *NameAtom::Intern(std::string_view name)
+{
+	if (const NameAtom *atom = Find(name))
+	{
+		return atom;
+	}
+
+	Table &instance = table();
+	std::unique_lock<std::shared_mutex> lock(instance.mutex);
+
+	AtomTable &atoms = instance.atoms;
+	auto it = atoms.find(name);
+	if (it != atoms.end())
+	{
+		return it->second.get();
+	}
+
+	std::string lower(name);
+	for (char &c : lower)
+	{
+		c = asciiLower(c);
+	}
+
+	std::unique_ptr<NameAtom> atom(new NameAtom(std::move(lower)));
+	const NameAtom *result = atom.get();
+	atoms.emplace(result->str(), std::move(atom));
+	return result;
+}
+
+bool NameAtom::SameName(xmlNodePtr a, xmlNodePtr b)
+{
+	if (a->name == nullptr || b->name == nullptr)
+	{
+		return false;
+	}
+
+	const NameAtom *left = Of(a);
+	const NameAtom *right = Of(b);
+	if (left != nullptr && right != nullptr)
+	{
+		return left == right;
+	}
+	return xmlStrcasecmp(a->name, b->name) == 0;
+}
+
+bool NameAtom::Equals(const xmlChar *name) const
+{
+	if (name == nullptr)
+	{
+		return false;
+	}
+
+	const char *cur = reinterpret_cast<const char *>(name);
+	for (char c : name_)
+	{
+		if (*cur == '\0' || asciiLower(*cur) != c)
+		{
+			return false;
+		}
+		cur++;
+	}
+	return *cur == '\0';
+}
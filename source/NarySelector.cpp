@@ -0,0 +1,68 @@
+#include "NarySelector.h"
+
+#include <algorithm>
+
+NarySelector::NarySelector(Operator _operator, std::vector<SelectorPtr> selectors) : selectors_(std::move(selectors)), operator_(_operator)
+{
+	usesAncestorFilter_ = std::any_of(selectors_.begin(), selectors_.end(), [](const SelectorPtr &selector)
+									  { return selector->usesAncestorFilter(); });
+}
+
+bool NarySelector::matches(xmlNodePtr node) const
+{
+	if (operator_ == Operator::Union)
+	{
+		return std::any_of(selectors_.begin(), selectors_.end(), [node](const SelectorPtr &selector)
+						   { return selector->matches(node); });
+	}
+	return std::all_of(selectors_.begin(), selectors_.end(), [node](const SelectorPtr &selector)
+					   { return selector->matches(node); });
+}
+
+bool NarySelector::matches(xmlNodePtr node, const MatchContext &context) const
+{
+	if (operator_ == Operator::Union)
+	{
+		return std::any_of(selectors_.begin(), selectors_.end(), [node, &context](const SelectorPtr &selector)
+						   { return selector->matches(node, context); });
+	}
+	return std::all_of(selectors_.begin(), selectors_.end(), [node, &context](const SelectorPtr &selector)
+					   { return selector->matches(node, context); });
+}
+
+void NarySelector::collectSubjectKeys(std::vector<std::uint32_t> &keys) const
+{
+	// A union's branches may each require different keys.
+	if (operator_ == Operator::Intersection)
+	{
+		for (const SelectorPtr &selector : selectors_)
+		{
+			selector->collectSubjectKeys(keys);
+		}
+	}
+}
+
+void NarySelector::collectAncestorKeys(std::vector<std::uint32_t> &keys) const
+{
+	if (operator_ == Operator::Intersection)
+	{
+		for (const SelectorPtr &selector : selectors_)
+		{
+			selector->collectAncestorKeys(keys);
+		}
+	}
+}
+
+std::string NarySelector::toString() const
+{
+	std::string result;
+	for (const SelectorPtr &selector : selectors_)
+	{
+		if (!result.empty())
+		{
+			result += operator_ == Operator::Union ? ", " : " ";
+		}
+		result += selector->toString();
+	}
+	return result;
+}
@@ -1,5 +1,7 @@
 #include "Node.h"
 #include "QueryResult.h"
+#include "SelectorCache.h"
+#include "MatchCursor.h"
 #include <libxml/xmlsave.h>
 
 std::optional<Node> Node::Parent() const
@@ -205,7 +207,7 @@ QueryResult Node::NextSiblings() const
 	{
 		if (sibling->type == XML_ELEMENT_NODE)
 		{
-			nodes.emplace(sibling);
+			nodes.push_back(sibling);
 		}
 		sibling = sibling->next;
 	}
@@ -231,7 +233,7 @@ QueryResult Node::Siblings() const
 	{
 		if (siblings->type == XML_ELEMENT_NODE && siblings != node_)
 		{
-			nodes.emplace(siblings);
+			nodes.push_back(siblings);
 		}
 	}
 	return nodes;
@@ -247,6 +249,67 @@ QueryResult Node::Find(const SelectorPtr selector) const
 	return QueryResult::Find(node_, selector);
 }
 
+QueryResult Node::Find(std::string_view selector, std::size_t limit) const
+{
+	return QueryResult::Find(node_, selector, limit);
+}
+
+QueryResult Node::Find(const SelectorPtr &selector, std::size_t limit) const
+{
+	return QueryResult::Find(node_, selector, limit);
+}
+
+std::optional<Node> Node::FindFirst(std::string_view selector) const
+{
+	return QueryResult(node_).FindFirst(selector);
+}
+
+std::optional<Node> Node::FindFirst(const SelectorPtr &selector) const
+{
+	return QueryResult(node_).FindFirst(selector);
+}
+
+bool Node::Exists(std::string_view selector) const
+{
+	return QueryResult(node_).Exists(selector);
+}
+
+bool Node::Exists(const SelectorPtr &selector) const
+{
+	return QueryResult(node_).Exists(selector);
+}
+
+std::size_t Node::Count(std::string_view selector) const
+{
+	return QueryResult(node_).Count(selector);
+}
+
+std::size_t Node::Count(const SelectorPtr &selector) const
+{
+	return QueryResult(node_).Count(selector);
+}
+
+void Node::ForEach(std::string_view selector, const std::function<bool(Node)> &visit) const
+{
+	ForEach(SelectorCache::Global().get(selector), visit);
+}
+
+void Node::ForEach(const SelectorPtr &selector, const std::function<bool(Node)> &visit) const
+{
+	selector->ForEachMatch(node_, [&visit](xmlNodePtr node)
+						   { return visit(Node(node)); });
+}
+
+MatchRange Node::Stream(std::string_view selector) const
+{
+	return MatchRange(SelectorCache::Global().get(selector), node_);
+}
+
+MatchRange Node::Stream(const SelectorPtr &selector) const
+{
+	return MatchRange(selector, node_);
+}
+
 QueryResult Node::PrevSiblings() const
 {
 	QueryResult::NodeSet nodes;
@@ -256,26 +319,18 @@ QueryResult Node::PrevSiblings() const
 		return nodes;
 	}
 
-	xmlNodePtr sibling = node_->prev;
-
-	std::vector<Node> temp_nodes;
-	while (sibling != nullptr)
+	xmlNodePtr first = node_;
+	for (xmlNodePtr sibling = node_->prev; sibling != nullptr; sibling = sibling->prev)
 	{
-		if (sibling->type == XML_ELEMENT_NODE)
-		{
-			temp_nodes.push_back(Node(sibling));
-		}
-		sibling = sibling->prev;
+		first = sibling;
 	}
 
-	sibling = node_->prev;
-	while (sibling != nullptr)
+	for (xmlNodePtr sibling = first; sibling != node_; sibling = sibling->next)
 	{
 		if (sibling->type == XML_ELEMENT_NODE)
 		{
-			nodes.emplace(sibling);
+			nodes.push_back(sibling);
 		}
-		sibling = sibling->prev;
 	}
 
 	return nodes;
@@ -294,7 +349,7 @@ QueryResult Node::Children() const
 	{
 		if (child->type == XML_ELEMENT_NODE)
 		{
-			nodes.emplace(child);
+			nodes.push_back(child);
 		}
 	}
 
@@ -415,27 +470,29 @@ std::vector<std::string> Node::Classes() const
 	return class_list;
 }
 
-std::optional<Node> Node::Closest(std::string_view selector) const
+bool Node::Matches(std::string_view selector) const
 {
-	if (node_ == nullptr)
-	{
-		return std::nullopt;
-	}
-
-	xmlNodePtr current = node_;
+	return Matches(SelectorCache::Global().get(selector));
+}
 
-	while (current != nullptr)
-	{
-		Node current_node_obj(current);
+bool Node::Matches(const SelectorPtr &selector) const
+{
+	return node_ != nullptr && node_->type == XML_ELEMENT_NODE && selector->matches(node_);
+}
 
-		QueryResult match_result = QueryResult::Find(current, selector);
+std::optional<Node> Node::Closest(std::string_view selector) const
+{
+	return Closest(SelectorCache::Global().get(selector));
+}
 
-		if (!match_result.empty() /*&& match_result.size() == 1 */)
+std::optional<Node> Node::Closest(const SelectorPtr &selector) const
+{
+	for (xmlNodePtr current = node_; current != nullptr; current = current->parent)
+	{
+		if (current->type == XML_ELEMENT_NODE && selector->matches(current))
 		{
-			return current_node_obj;
+			return Node(current);
 		}
-
-		current = current->parent;
 	}
 
 	return std::nullopt;
@@ -0,0 +1,144 @@
+#include "NodeSet.h"
+#include "ElementInfo.h"
+
+#include <algorithm>
+#include <iterator>
+
+static inline std::size_t nodeDepth(xmlNodePtr node)
+{
+	std::size_t depth = 0;
+	for (; node->parent != nullptr; node = node->parent)
+	{
+		depth++;
+	}
+	return depth;
+}
+
+bool NodeSet::DocumentOrderLess(xmlNodePtr a, xmlNodePtr b)
+{
+	if (a == b)
+	{
+		return false;
+	}
+
+	// Elements of an indexed document carry their document order.
+	auto [infoA, infoB] = ElementInfo::Of(a, b);
+	if (infoA != nullptr)
+	{
+		return infoA->order < infoB->order;
+	}
+
+	std::size_t depthA = nodeDepth(a);
+	std::size_t depthB = nodeDepth(b);
+
+	xmlNodePtr pa = a;
+	xmlNodePtr pb = b;
+
+	for (; depthA > depthB; depthA--)
+	{
+		pa = pa->parent;
+	}
+	for (; depthB > depthA; depthB--)
+	{
+		pb = pb->parent;
+	}
+
+	if (pa == pb)
+	{
+		// One node is an ancestor of the other, ancestors come first.
+		return pa == a;
+	}
+
+	while (pa->parent != pb->parent)
+	{
+		pa = pa->parent;
+		pb = pb->parent;
+	}
+
+	if (pa->parent == nullptr)
+	{
+		// Unrelated trees, any stable order will do.
+		return pa < pb;
+	}
+
+	xmlNodePtr forward = pa->next;
+	xmlNodePtr backward = pa->prev;
+
+	while (forward != nullptr || backward != nullptr)
+	{
+		if (forward == pb)
+		{
+			return true;
+		}
+		if (backward == pb)
+		{
+			return false;
+		}
+		if (forward != nullptr)
+		{
+			forward = forward->next;
+		}
+		if (backward != nullptr)
+		{
+			backward = backward->prev;
+		}
+	}
+	return false;
+}
+
+NodeSet::NodeSet(std::initializer_list<xmlNodePtr> nodes)
+{
+	nodes_.reserve(nodes.size());
+	for (xmlNodePtr node : nodes)
+	{
+		insert(node);
+	}
+}
+
+std::pair<NodeSet::iterator, bool> NodeSet::insert(xmlNodePtr node)
+{
+	if (nodes_.empty() || DocumentOrderLess(nodes_.back(), node))
+	{
+		nodes_.push_back(node);
+		return std::make_pair(std::prev(nodes_.cend()), true);
+	}
+
+	auto it = std::lower_bound(nodes_.cbegin(), nodes_.cend(), node, DocumentOrderLess);
+
+	if (*it == node)
+	{
+		return std::make_pair(it, false);
+	}
+	return std::make_pair(nodes_.insert(it, node), true);
+}
+
+NodeSet::iterator NodeSet::find(xmlNodePtr node) const
+{
+	auto it = std::lower_bound(nodes_.cbegin(), nodes_.cend(), node, DocumentOrderLess);
+
+	if (it != nodes_.cend() && *it == node)
+	{
+		return it;
+	}
+	return nodes_.cend();
+}
+
+void NodeSet::merge(const NodeSet &other)
+{
+	if (other.empty())
+	{
+		return;
+	}
+
+	if (nodes_.empty() || DocumentOrderLess(nodes_.back(), other.front()))
+	{
+		nodes_.insert(nodes_.end(), other.begin(), other.end());
+		return;
+	}
+
+	container_type merged;
+	merged.reserve(nodes_.size() + other.size());
+	std::merge(nodes_.cbegin(), nodes_.cend(), other.begin(), other.end(), std::back_inserter(merged), DocumentOrderLess);
+	merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+	nodes_.swap(merged);
+}
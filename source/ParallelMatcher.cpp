@@ -0,0 +1,356 @@
+#include "ParallelMatcher.h"
+#include "MatchContext.h"
+#include "MatchCursor.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	struct Task
+	{
+		xmlNodePtr root = nullptr;
+		std::vector<xmlNodePtr> matches;
+		// Tasks split off this one, each with the number of matches found
+		// before it in document order.
+		std::vector<std::pair<std::size_t, Task *>> splits;
+	};
+
+	// Threads kept for the parallel queries of the process, asleep on a
+	// condition variable between queries. One query has them at a time.
+	class Workers
+	{
+	public:
+		static Workers &Shared()
+		{
+			static Workers workers;
+			return workers;
+		}
+
+		~Workers()
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				stop_ = true;
+			}
+			wake_.notify_all();
+			for (std::thread &thread : threads_)
+			{
+				thread.join();
+			}
+		}
+
+		// Calls work(i) for every i below count, work(0) on the calling
+		// thread, and returns once every call has. Returns false, calling
+		// nothing, while another query has the workers.
+		bool run(std::size_t count, const std::function<void(std::size_t)> &work)
+		{
+			std::unique_lock<std::mutex> busy(busy_, std::try_to_lock);
+			if (!busy.owns_lock())
+			{
+				return false;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				while (threads_.size() + 1 < count)
+				{
+					threads_.emplace_back(&Workers::loop, this, threads_.size() + 1);
+				}
+				work_ = &work;
+				count_ = count;
+				running_ = count - 1;
+				generation_++;
+			}
+			wake_.notify_all();
+
+			work(0);
+
+			std::unique_lock<std::mutex> lock(mutex_);
+			done_.wait(lock, [this]()
+					   { return running_ == 0; });
+			work_ = nullptr;
+			return true;
+		}
+
+	private:
+		void loop(std::size_t index)
+		{
+			// Threads start within run, so the first generation they see is
+			// the query that started them.
+			std::uint64_t seen = 0;
+
+			std::unique_lock<std::mutex> lock(mutex_);
+			while (true)
+			{
+				wake_.wait(lock, [this, &seen]()
+						   { return stop_ || generation_ != seen; });
+				if (stop_)
+				{
+					return;
+				}
+				seen = generation_;
+				if (index >= count_)
+				{
+					continue;
+				}
+
+				const std::function<void(std::size_t)> *work = work_;
+				lock.unlock();
+				(*work)(index);
+				lock.lock();
+
+				if (--running_ == 0)
+				{
+					done_.notify_all();
+				}
+			}
+		}
+
+	private:
+		std::mutex busy_;
+
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		std::vector<std::thread> threads_;
+		const std::function<void(std::size_t)> *work_ = nullptr;
+		std::size_t count_ = 0;
+		std::size_t running_ = 0;
+		std::uint64_t generation_ = 0;
+		bool stop_ = false;
+	};
+
+	class Pool
+	{
+	public:
+		Pool(const Selector &selector, xmlNodePtr scope, std::size_t threads) : selector_(selector), scope_(scope), queues_(threads), storage_(threads) {}
+
+		void run()
+		{
+			root_ = spawn(scope_, 0);
+
+			std::function<void(std::size_t)> work = [this](std::size_t self)
+			{ this->work(self); };
+			// With the workers taken, the caller alone drains the tasks.
+			if (!Workers::Shared().run(queues_.size(), work))
+			{
+				work(0);
+			}
+
+			if (error_)
+			{
+				std::rethrow_exception(error_);
+			}
+		}
+
+		void collect(NodeSet &result) const { emit(*root_, result); }
+
+	private:
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Task *> tasks;
+		};
+
+		Task *spawn(xmlNodePtr root, std::size_t self)
+		{
+			// Only the owning thread grows its storage, and a deque keeps the
+			// tasks already handed out in place.
+			Task &task = storage_[self].emplace_back();
+			task.root = root;
+
+			{
+				std::lock_guard<std::mutex> lock(queues_[self].mutex);
+				queues_[self].tasks.push_back(&task);
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pending_++;
+				queued_++;
+			}
+			wake_.notify_one();
+			return &task;
+		}
+
+		Task *take(std::size_t self)
+		{
+			Task *task = nullptr;
+			{
+				Queue &own = queues_[self];
+				std::lock_guard<std::mutex> lock(own.mutex);
+				if (!own.tasks.empty())
+				{
+					task = own.tasks.back();
+					own.tasks.pop_back();
+				}
+			}
+
+			for (std::size_t i = 1; task == nullptr && i < queues_.size(); i++)
+			{
+				Queue &victim = queues_[(self + i) % queues_.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.tasks.empty())
+				{
+					task = victim.tasks.front();
+					victim.tasks.pop_front();
+				}
+			}
+
+			if (task != nullptr)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				queued_--;
+			}
+			return task;
+		}
+
+		void work(std::size_t self)
+		{
+			MatchContext context;
+			context.useAncestorFilter = selector_.usesAncestorFilter();
+			// One walk over the whole scope serves every task this thread
+			// runs, so what the context computes over the scope, such as
+			// the marks of :has(), is computed once per thread.
+			SubtreeWalk walk(scope_, context);
+
+			while (!failed_.load(std::memory_order_relaxed))
+			{
+				Task *task = take(self);
+				if (task == nullptr)
+				{
+					std::unique_lock<std::mutex> lock(mutex_);
+					if (pending_ == 0 || failed_.load(std::memory_order_relaxed))
+					{
+						break;
+					}
+					if (queued_ == 0)
+					{
+						idle_.fetch_add(1, std::memory_order_relaxed);
+						wake_.wait(lock, [this]()
+								   { return queued_ != 0 || pending_ == 0 || failed_.load(std::memory_order_relaxed); });
+						idle_.fetch_sub(1, std::memory_order_relaxed);
+					}
+					continue;
+				}
+
+				try
+				{
+					execute(*task, self, context, walk);
+				}
+				catch (...)
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					if (!error_)
+					{
+						error_ = std::current_exception();
+					}
+					failed_.store(true, std::memory_order_relaxed);
+					wake_.notify_all();
+				}
+
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (--pending_ == 0)
+				{
+					wake_.notify_all();
+				}
+			}
+		}
+
+		void execute(Task &task, std::size_t self, MatchContext &context, SubtreeWalk &walk)
+		{
+			walk.restart(task.root);
+
+			while (xmlNodePtr current = walk.next())
+			{
+				if (selector_.matches(current, context))
+				{
+					task.matches.push_back(current);
+				}
+
+				if (current->type != XML_ELEMENT_NODE || idle_.load(std::memory_order_relaxed) == 0)
+				{
+					continue;
+				}
+
+				// Someone is out of work: hand the children over instead of
+				// descending. Their matches follow current's in document
+				// order and precede everything the walk has left.
+				bool split = false;
+				for (xmlNodePtr child = current->children; child != nullptr; child = child->next)
+				{
+					if (child->type == XML_ELEMENT_NODE)
+					{
+						task.splits.emplace_back(task.matches.size(), spawn(child, self));
+						split = true;
+					}
+				}
+				if (split)
+				{
+					walk.skipChildren();
+				}
+			}
+		}
+
+		static void emit(const Task &task, NodeSet &result)
+		{
+			std::size_t next = 0;
+			for (const auto &split : task.splits)
+			{
+				for (; next < split.first; next++)
+				{
+					result.push_back(task.matches[next]);
+				}
+				emit(*split.second, result);
+			}
+			for (; next < task.matches.size(); next++)
+			{
+				result.push_back(task.matches[next]);
+			}
+		}
+
+	private:
+		const Selector &selector_;
+		xmlNodePtr scope_;
+		std::vector<Queue> queues_;
+		std::vector<std::deque<Task>> storage_;
+		Task *root_ = nullptr;
+
+		// Guards the counts below and error_; wake_ signals a change in them.
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		// Tasks not finished, and those not yet taken.
+		std::size_t pending_ = 0;
+		std::size_t queued_ = 0;
+		std::atomic<std::size_t> idle_{0};
+		std::atomic<bool> failed_{false};
+		std::exception_ptr error_;
+	};
+} // namespace
+
+NodeSet ParallelMatcher::MatchAll(const Selector &selector, xmlNodePtr scope, std::size_t threads)
+{
+	if (threads == 0)
+	{
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (scope == nullptr || threads == 1)
+	{
+		return selector.MatchAll(scope);
+	}
+
+	Pool pool(selector, scope, threads);
+	pool.run();
+
+	NodeSet result;
+	pool.collect(result);
+	return result;
+}
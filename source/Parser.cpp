@@ -2,6 +2,8 @@
 
 #include "AttributeSelector.h"
 #include "BinarySelector.h"
+#include "CompiledSelector.h"
+#include "SelectorOptimizer.h"
 #include "TagSelector.h"
 #include "TextSelector.h"
 #include "UnarySelector.h"
@@ -67,9 +69,18 @@ namespace
         {"checked", SelectorType::Checked}};
 } // namespace
 
-SelectorPtr SelectorParser::Create(std::string_view selectorString)
+SelectorPtr SelectorParser::Create(std::string_view selectorString, bool compile, bool optimize)
 {
-    return SelectorParser(selectorString).ParseSelectorGroup();
+    SelectorPtr selector = SelectorParser(selectorString).ParseSelectorGroup();
+    if (optimize)
+    {
+        selector = SelectorOptimizer::Optimize(selector);
+    }
+    if (compile)
+    {
+        return std::make_shared<CompiledSelector>(selector);
+    }
+    return selector;
 }
 
 SelectorPtr SelectorParser::ParseSelectorGroup()
@@ -405,7 +416,14 @@ SelectorPtr SelectorParser::ParsePseudoclassSelector()
         {
             _operator = TextSelector::Operator::MatchesOwn;
         }
-        return std::make_shared<TextSelector>(_operator, value);
+        try
+        {
+            return std::make_shared<TextSelector>(_operator, value);
+        }
+        catch (const std::regex_error &e)
+        {
+            throw error(std::string("invalid or unsupported regex: ") + e.what());
+        }
     }
     case SelectorType::NthChild:
     case SelectorType::NthLastChild:
@@ -623,7 +641,14 @@ SelectorPtr SelectorParser::ParseAttributeSelector()
         throw error("unsupported _operator:" + _operator);
     }
 #undef OPERATOR_CASE
-    return std::make_shared<AttributeSelector>(attr_op, key, value, icase);
+    try
+    {
+        return std::make_shared<AttributeSelector>(attr_op, key, value, icase);
+    }
+    catch (const std::regex_error &e)
+    {
+        throw error(std::string("invalid or unsupported regex: ") + e.what());
+    }
 }
 
 SelectorPtr SelectorParser::ParseClassSelector()
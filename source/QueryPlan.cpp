@@ -0,0 +1,71 @@
+#include "QueryPlan.h"
+
+#include <sstream>
+
+namespace
+{
+	static void describe(const QueryPlan &plan, const std::string &indent, std::stringstream &ss)
+	{
+		ss << indent << QueryPlan::StrategyName(plan.strategy);
+		if (!plan.key.empty())
+		{
+			ss << " " << plan.key;
+		}
+		ss << ": " << plan.cost << ", scan " << plan.scanCost << "\n";
+
+		bool first = true;
+		for (const QueryPlan::Option &option : plan.considered)
+		{
+			if (option.strategy == plan.strategy && option.key == plan.key)
+			{
+				continue;
+			}
+			ss << (first ? indent + "  rejected: " : ", ") << QueryPlan::StrategyName(option.strategy);
+			if (!option.key.empty())
+			{
+				ss << " " << option.key;
+			}
+			ss << " " << option.cost;
+			first = false;
+		}
+		if (!first)
+		{
+			ss << "\n";
+		}
+
+		for (const QueryPlan &branch : plan.branches)
+		{
+			describe(branch, indent + "  ", ss);
+		}
+	}
+} // namespace
+
+const char *QueryPlan::StrategyName(Strategy strategy)
+{
+	switch (strategy)
+	{
+	case Strategy::Scan:
+		return "scan";
+	case Strategy::IdSeed:
+		return "seed id";
+	case Strategy::TagSeed:
+		return "seed tag";
+	case Strategy::ClassSeed:
+		return "seed class";
+	case Strategy::ScopedDescent:
+		return "scoped descent from id";
+	case Strategy::StructuralJoin:
+		return "structural join";
+	case Strategy::Union:
+		return "union";
+	default:
+		return "?";
+	}
+}
+
+std::string QueryPlan::toString() const
+{
+	std::stringstream ss;
+	describe(*this, "", ss);
+	return ss.str();
+}
@@ -1,17 +1,46 @@
 #include "QueryResult.h"
-#include "Parser.h"
+#include "SelectorCache.h"
 #include "Node.h"
+#include "DocumentIndex.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	// Nodes of a result nested in an earlier one add no matches of their own,
+	// since searches include the node they start from.
+	bool isInclusiveAncestor(xmlNodePtr ancestor, xmlNodePtr node)
+	{
+		return ElementInfo::IsInclusiveAncestor(ancestor, node);
+	}
+
+	NodeSet sortedSet(std::vector<xmlNodePtr> &nodes)
+	{
+		std::sort(nodes.begin(), nodes.end(), NodeSet::DocumentOrderLess);
+		nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+		NodeSet set;
+		set.reserve(nodes.size());
+		for (xmlNodePtr node : nodes)
+		{
+			set.push_back(node);
+		}
+		return set;
+	}
+} // namespace
 
 QueryResult::QueryResult(xmlNodePtr apNode)
 {
 	if (apNode != nullptr)
 	{
-		nodes_.insert(apNode);
+		nodes_.push_back(apNode);
 	}
 }
 
-QueryResult::iterator QueryResult::begin() { return QueryResult::iterator(nodes_.begin()); }
-QueryResult::iterator QueryResult::end() { return QueryResult::iterator(nodes_.end()); }
+QueryResult::iterator QueryResult::begin() const { return QueryResult::iterator(nodes_.begin()); }
+QueryResult::iterator QueryResult::end() const { return QueryResult::iterator(nodes_.end()); }
 
 std::optional<Node> QueryResult::operator[](std::size_t index) const
 {
@@ -20,35 +49,232 @@ std::optional<Node> QueryResult::operator[](std::size_t index) const
 		return std::nullopt;
 	}
 
-	auto it = nodes_.cbegin();
-	std::advance(it, index);
-	return Node(*it);
+	return Node(nodes_[index]);
 }
 
 QueryResult QueryResult::Find(std::string_view selector) const
 {
-	return Find(SelectorParser::Create(selector));
+	return Find(SelectorCache::Global().get(selector));
 }
 
 QueryResult QueryResult::Find(const SelectorPtr &selector) const
+{
+	return Find(selector, SIZE_MAX);
+}
+
+QueryResult QueryResult::Find(xmlNodePtr node, std::string_view selector)
+{
+	return Find(node, SelectorCache::Global().get(selector));
+}
+
+QueryResult QueryResult::Find(xmlNodePtr node, const SelectorPtr &selector)
+{
+	return Find(node, selector, SIZE_MAX);
+}
+
+QueryResult QueryResult::Find(std::string_view selector, std::size_t limit) const
+{
+	return Find(SelectorCache::Global().get(selector), limit);
+}
+
+QueryResult QueryResult::Find(const SelectorPtr &selector, std::size_t limit) const
 {
 	NodeSet ret;
+	xmlNodePtr root = nullptr;
 	for (xmlNodePtr pNode : nodes_)
 	{
-		NodeSet matched = selector->MatchAll(pNode);
-		ret.merge(matched);
+		if (ret.size() >= limit)
+		{
+			break;
+		}
+		if (root != nullptr && isInclusiveAncestor(root, pNode))
+		{
+			continue;
+		}
+		root = pNode;
+		for (xmlNodePtr match : Find(pNode, selector, limit - ret.size()).nodes_)
+		{
+			ret.push_back(match);
+		}
 	}
-	return QueryResult(ret);
+	return QueryResult(std::move(ret));
 }
 
-QueryResult QueryResult::Find(xmlNodePtr node, std::string_view selector)
+QueryResult QueryResult::Find(xmlNodePtr node, std::string_view selector, std::size_t limit)
 {
-	return Find(node, SelectorParser::Create(selector));
+	return Find(node, SelectorCache::Global().get(selector), limit);
 }
 
-QueryResult QueryResult::Find(xmlNodePtr node, const SelectorPtr &selector)
+QueryResult QueryResult::Find(xmlNodePtr node, const SelectorPtr &selector, std::size_t limit)
+{
+	if (const DocumentIndex *index = DocumentIndex::FromNode(node))
+	{
+		NodeSet nodes;
+		if (index->Find(node, *selector, nodes, limit))
+		{
+			return QueryResult(std::move(nodes));
+		}
+	}
+	return QueryResult(selector->MatchAll(node, limit));
+}
+
+std::optional<Node> QueryResult::FindFirst(std::string_view selector) const
+{
+	return FindFirst(SelectorCache::Global().get(selector));
+}
+
+std::optional<Node> QueryResult::FindFirst(const SelectorPtr &selector) const
+{
+	QueryResult result = Find(selector, 1);
+	if (result.empty())
+	{
+		return std::nullopt;
+	}
+	return result.front();
+}
+
+bool QueryResult::Exists(std::string_view selector) const
+{
+	return Exists(SelectorCache::Global().get(selector));
+}
+
+bool QueryResult::Exists(const SelectorPtr &selector) const
 {
-	return QueryResult(selector->MatchAll(node));
+	return FindFirst(selector).has_value();
+}
+
+std::size_t QueryResult::Count(std::string_view selector) const
+{
+	return Count(SelectorCache::Global().get(selector));
+}
+
+std::size_t QueryResult::Count(const SelectorPtr &selector) const
+{
+	std::size_t count = 0;
+	xmlNodePtr root = nullptr;
+	for (xmlNodePtr pNode : nodes_)
+	{
+		if (root != nullptr && isInclusiveAncestor(root, pNode))
+		{
+			continue;
+		}
+		root = pNode;
+
+		NodeSet nodes;
+		const DocumentIndex *index = DocumentIndex::FromNode(pNode);
+		if (index != nullptr && index->Find(pNode, *selector, nodes))
+		{
+			count += nodes.size();
+		}
+		else
+		{
+			count += selector->CountMatches(pNode);
+		}
+	}
+	return count;
+}
+
+void QueryResult::ForEach(std::string_view selector, const std::function<bool(Node)> &visit) const
+{
+	ForEach(SelectorCache::Global().get(selector), visit);
+}
+
+void QueryResult::ForEach(const SelectorPtr &selector, const std::function<bool(Node)> &visit) const
+{
+	bool stopped = false;
+	xmlNodePtr root = nullptr;
+	for (xmlNodePtr pNode : nodes_)
+	{
+		if (root != nullptr && isInclusiveAncestor(root, pNode))
+		{
+			continue;
+		}
+		root = pNode;
+
+		selector->ForEachMatch(pNode, [&visit, &stopped](xmlNodePtr node)
+							   {
+			stopped = !visit(Node(node));
+			return !stopped; });
+		if (stopped)
+		{
+			return;
+		}
+	}
+}
+
+QueryResult QueryResult::Closest(std::string_view selector) const
+{
+	return Closest(SelectorCache::Global().get(selector));
+}
+
+QueryResult QueryResult::Closest(const SelectorPtr &selector) const
+{
+	// Answer for every node walked so far, nullptr when nothing matched.
+	std::unordered_map<xmlNodePtr, xmlNodePtr> closest;
+	std::vector<xmlNodePtr> path;
+	std::vector<xmlNodePtr> found;
+
+	for (xmlNodePtr node : nodes_)
+	{
+		xmlNodePtr match = nullptr;
+		path.clear();
+
+		for (xmlNodePtr current = node; current != nullptr; current = current->parent)
+		{
+			auto it = closest.find(current);
+			if (it != closest.end())
+			{
+				match = it->second;
+				break;
+			}
+			path.push_back(current);
+			if (current->type == XML_ELEMENT_NODE && selector->matches(current))
+			{
+				match = current;
+				break;
+			}
+		}
+
+		for (xmlNodePtr visited : path)
+		{
+			closest.emplace(visited, match);
+		}
+		if (match != nullptr)
+		{
+			found.push_back(match);
+		}
+	}
+
+	return QueryResult(sortedSet(found));
+}
+
+QueryResult QueryResult::Parents(std::string_view selector) const
+{
+	return Parents(SelectorCache::Global().get(selector));
+}
+
+QueryResult QueryResult::Parents(const SelectorPtr &selector) const
+{
+	// Once an ancestor has been visited, so have all of its own ancestors.
+	std::unordered_set<xmlNodePtr> visited;
+	std::vector<xmlNodePtr> found;
+
+	for (xmlNodePtr node : nodes_)
+	{
+		for (xmlNodePtr current = node->parent; current != nullptr; current = current->parent)
+		{
+			if (!visited.insert(current).second)
+			{
+				break;
+			}
+			if (current->type == XML_ELEMENT_NODE && selector->matches(current))
+			{
+				found.push_back(current);
+			}
+		}
+	}
+
+	return QueryResult(sortedSet(found));
 }
 
 std::optional<Node> QueryResult::at(std::size_t i) const
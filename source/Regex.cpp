@@ -0,0 +1,1156 @@
+#include "Regex.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cctype>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	static std::atomic<bool> stdFallback{false};
+
+	// Index just past the character class starting at pattern[i] == '['.
+	static std::size_t skipClass(std::string_view pattern, std::size_t i)
+	{
+		i++;
+		if (i < pattern.length() && pattern[i] == '^')
+		{
+			i++;
+		}
+		if (i < pattern.length() && pattern[i] == ']')
+		{
+			i++;
+		}
+		while (i < pattern.length() && pattern[i] != ']')
+		{
+			i += pattern[i] == '\\' ? 2 : 1;
+		}
+		return i + 1;
+	}
+
+	// Index just past the group starting at pattern[i] == '('.
+	static std::size_t skipGroup(std::string_view pattern, std::size_t i)
+	{
+		int depth = 0;
+		while (i < pattern.length())
+		{
+			switch (pattern[i])
+			{
+			case '\\':
+				i += 2;
+				continue;
+			case '[':
+				i = skipClass(pattern, i);
+				continue;
+			case '(':
+				depth++;
+				break;
+			case ')':
+				if (--depth == 0)
+				{
+					return i + 1;
+				}
+				break;
+			default:
+				break;
+			}
+			i++;
+		}
+		return i;
+	}
+
+	// Length of the escape sequence starting at pattern[i] == '\\'.
+	static std::size_t escapeLength(std::string_view pattern, std::size_t i)
+	{
+		std::size_t j = i + 1;
+		if (j >= pattern.length())
+		{
+			return 1;
+		}
+
+		char e = pattern[j++];
+		std::size_t max = 0;
+		int (*accept)(int) = ::isdigit;
+
+		if (e == 'x' || e == 'u')
+		{
+			max = e == 'x' ? 2 : 4;
+			accept = ::isxdigit;
+		}
+		else if (e == 'c')
+		{
+			max = 1;
+			accept = ::isalpha;
+		}
+		else if (std::isdigit(static_cast<unsigned char>(e)))
+		{
+			max = pattern.length();
+		}
+
+		while (max > 0 && j < pattern.length() && accept(static_cast<unsigned char>(pattern[j])))
+		{
+			j++;
+			max--;
+		}
+		return j - i;
+	}
+
+	// Parses a {n}, {n,} or {n,m} quantifier at pattern[i] == '{'. Returns
+	// the index past it and stores the bounds (max < 0 when unbounded), or
+	// returns i if it is not a quantifier.
+	static std::size_t readBraces(std::string_view pattern, std::size_t i, long &min, long &max)
+	{
+		auto number = [&](std::size_t &j, long &value)
+		{
+			value = 0;
+			std::size_t start = j;
+			while (j < pattern.length() && std::isdigit(static_cast<unsigned char>(pattern[j])))
+			{
+				value = std::min(value * 10 + (pattern[j] - '0'), 1000000L);
+				j++;
+			}
+			return j > start;
+		};
+
+		std::size_t j = i + 1;
+		if (!number(j, min))
+		{
+			return i;
+		}
+		max = min;
+		if (j < pattern.length() && pattern[j] == ',')
+		{
+			j++;
+			if (!number(j, max))
+			{
+				max = -1;
+			}
+		}
+		if (j >= pattern.length() || pattern[j] != '}')
+		{
+			return i;
+		}
+		return j + 1;
+	}
+
+	using ByteSet = std::bitset<256>;
+
+	static inline bool isWordByte(int c)
+	{
+		return c >= 0 && (std::isalnum(c) || c == '_');
+	}
+
+	// Thrown for a valid pattern the linear engine cannot run.
+	struct Unsupported
+	{
+	};
+
+	struct Ast
+	{
+		enum class Kind
+		{
+			Empty,
+			Set,
+			Concat,
+			Alternate,
+			Repeat,
+			Begin,
+			End,
+			WordBoundary,
+			NotWordBoundary,
+		};
+
+		Kind kind;
+		std::size_t set = 0;
+		long min = 0;
+		long max = 0;
+		std::vector<std::size_t> children;
+	};
+
+	// Recursive descent parser for the supported ECMAScript subset.
+	class PatternParser
+	{
+	public:
+		// Deepest group nesting accepted. Parsing and compiling recurse once
+		// per level, so this bounds their stack use.
+		static constexpr std::size_t kMaxDepth = 256;
+		// Largest bound of a {n,m} repetition. Bounded repetitions compile
+		// to one copy of their body per count.
+		static constexpr long kMaxRepeat = 1000;
+
+		PatternParser(std::string_view pattern, std::vector<Ast> &nodes, std::vector<ByteSet> &sets)
+			: pattern_(pattern), nodes_(nodes), sets_(sets) {}
+
+		std::size_t Parse()
+		{
+			std::size_t root = alternation();
+			if (pos_ < pattern_.length())
+			{
+				throw std::regex_error(std::regex_constants::error_paren);
+			}
+			return root;
+		}
+
+	private:
+		std::size_t add(Ast::Kind kind)
+		{
+			nodes_.push_back(Ast{kind, 0, 0, 0, {}});
+			return nodes_.size() - 1;
+		}
+
+		std::size_t addSet(const ByteSet &set)
+		{
+			std::size_t node = add(Ast::Kind::Set);
+			nodes_[node].set = sets_.size();
+			sets_.push_back(set);
+			return node;
+		}
+
+		bool more() const { return pos_ < pattern_.length(); }
+		char peek() const { return pattern_[pos_]; }
+
+		std::size_t alternation()
+		{
+			std::size_t first = sequence();
+			if (!more() || peek() != '|')
+			{
+				return first;
+			}
+
+			std::size_t node = add(Ast::Kind::Alternate);
+			nodes_[node].children.push_back(first);
+			while (more() && peek() == '|')
+			{
+				pos_++;
+				std::size_t branch = sequence();
+				nodes_[node].children.push_back(branch);
+			}
+			return node;
+		}
+
+		std::size_t sequence()
+		{
+			std::size_t node = add(Ast::Kind::Concat);
+			while (more() && peek() != '|' && peek() != ')')
+			{
+				std::size_t item = repeat();
+				nodes_[node].children.push_back(item);
+			}
+			return node;
+		}
+
+		std::size_t repeat()
+		{
+			bool assertion = false;
+			std::size_t atom = this->atom(assertion);
+
+			if (!more())
+			{
+				return atom;
+			}
+
+			long min = 0;
+			long max = 0;
+			switch (peek())
+			{
+			case '*':
+				min = 0;
+				max = -1;
+				pos_++;
+				break;
+			case '+':
+				min = 1;
+				max = -1;
+				pos_++;
+				break;
+			case '?':
+				min = 0;
+				max = 1;
+				pos_++;
+				break;
+			case '{':
+			{
+				std::size_t end = readBraces(pattern_, pos_, min, max);
+				if (end == pos_)
+				{
+					throw std::regex_error(std::regex_constants::error_badbrace);
+				}
+				if (max >= 0 && max < min)
+				{
+					throw std::regex_error(std::regex_constants::error_badbrace);
+				}
+				if (min > kMaxRepeat || max > kMaxRepeat)
+				{
+					throw std::regex_error(std::regex_constants::error_complexity);
+				}
+				pos_ = end;
+				break;
+			}
+			default:
+				return atom;
+			}
+
+			if (assertion)
+			{
+				throw std::regex_error(std::regex_constants::error_badrepeat);
+			}
+			// Greedy and lazy repetitions accept the same inputs.
+			if (more() && peek() == '?')
+			{
+				pos_++;
+			}
+			if (more() && (peek() == '*' || peek() == '+' || peek() == '?' || peek() == '{'))
+			{
+				throw std::regex_error(std::regex_constants::error_badrepeat);
+			}
+
+			std::size_t node = add(Ast::Kind::Repeat);
+			nodes_[node].min = min;
+			nodes_[node].max = max;
+			nodes_[node].children.push_back(atom);
+			return node;
+		}
+
+		std::size_t atom(bool &assertion)
+		{
+			char c = peek();
+			switch (c)
+			{
+			case '(':
+			{
+				pos_++;
+				if (more() && peek() == '?')
+				{
+					if (pos_ + 1 < pattern_.length() && pattern_[pos_ + 1] == ':')
+					{
+						pos_ += 2;
+					}
+					else
+					{
+						// Lookahead and other extensions.
+						throw Unsupported();
+					}
+				}
+				if (++depth_ > kMaxDepth)
+				{
+					throw std::regex_error(std::regex_constants::error_complexity);
+				}
+				std::size_t inner = alternation();
+				if (!more() || peek() != ')')
+				{
+					throw std::regex_error(std::regex_constants::error_paren);
+				}
+				pos_++;
+				depth_--;
+				return inner;
+			}
+			case '[':
+				return addSet(characterClass());
+			case '.':
+			{
+				pos_++;
+				ByteSet set;
+				set.set();
+				set.reset('\n');
+				set.reset('\r');
+				return addSet(set);
+			}
+			case '^':
+				pos_++;
+				assertion = true;
+				return add(Ast::Kind::Begin);
+			case '$':
+				pos_++;
+				assertion = true;
+				return add(Ast::Kind::End);
+			case '*':
+			case '+':
+			case '?':
+			case '{':
+				throw std::regex_error(std::regex_constants::error_badrepeat);
+			case '\\':
+				return escape(assertion);
+			default:
+			{
+				pos_++;
+				ByteSet set;
+				set.set(static_cast<unsigned char>(c));
+				return addSet(set);
+			}
+			}
+		}
+
+		std::size_t escape(bool &assertion)
+		{
+			pos_++;
+			if (!more())
+			{
+				throw std::regex_error(std::regex_constants::error_escape);
+			}
+
+			switch (peek())
+			{
+			case 'b':
+				pos_++;
+				assertion = true;
+				return add(Ast::Kind::WordBoundary);
+			case 'B':
+				pos_++;
+				assertion = true;
+				return add(Ast::Kind::NotWordBoundary);
+			default:
+			{
+				ByteSet set;
+				classEscape(set, false);
+				return addSet(set);
+			}
+			}
+		}
+
+		// Adds the escape at pos_ (just past the backslash) to set.
+		// Returns the byte it stands for, or -1 for a class like \d.
+		int classEscape(ByteSet &set, bool inClass)
+		{
+			char e = peek();
+			pos_++;
+
+			auto addIf = [&set](int (*test)(int), bool negate)
+			{
+				for (int c = 0; c < 256; c++)
+				{
+					bool in = c < 128 && test(c);
+					if (in != negate)
+					{
+						set.set(static_cast<std::size_t>(c));
+					}
+				}
+			};
+
+			int byte = -1;
+			switch (e)
+			{
+			case 'd':
+				addIf(::isdigit, false);
+				return -1;
+			case 'D':
+				addIf(::isdigit, true);
+				return -1;
+			case 's':
+				addIf(::isspace, false);
+				return -1;
+			case 'S':
+				addIf(::isspace, true);
+				return -1;
+			case 'w':
+				for (int c = 0; c < 256; c++)
+				{
+					if (isWordByte(c))
+					{
+						set.set(static_cast<std::size_t>(c));
+					}
+				}
+				return -1;
+			case 'W':
+				for (int c = 0; c < 256; c++)
+				{
+					if (!isWordByte(c))
+					{
+						set.set(static_cast<std::size_t>(c));
+					}
+				}
+				return -1;
+			case 'n':
+				byte = '\n';
+				break;
+			case 'r':
+				byte = '\r';
+				break;
+			case 't':
+				byte = '\t';
+				break;
+			case 'f':
+				byte = '\f';
+				break;
+			case 'v':
+				byte = '\v';
+				break;
+			case 'b':
+				// Backspace inside a class; \b outside one is an assertion.
+				byte = inClass ? '\b' : -1;
+				break;
+			case '0':
+				if (more() && std::isdigit(static_cast<unsigned char>(peek())))
+				{
+					throw Unsupported();
+				}
+				byte = 0;
+				break;
+			case 'x':
+			{
+				if (pos_ + 2 > pattern_.length() || !std::isxdigit(static_cast<unsigned char>(pattern_[pos_])) ||
+					!std::isxdigit(static_cast<unsigned char>(pattern_[pos_ + 1])))
+				{
+					throw std::regex_error(std::regex_constants::error_escape);
+				}
+				byte = std::stoi(std::string(pattern_.substr(pos_, 2)), nullptr, 16);
+				pos_ += 2;
+				break;
+			}
+			default:
+				if (std::isalnum(static_cast<unsigned char>(e)))
+				{
+					// Backreferences, \c, \u and unknown letter escapes.
+					throw Unsupported();
+				}
+				byte = static_cast<unsigned char>(e);
+				break;
+			}
+
+			if (byte < 0)
+			{
+				throw std::regex_error(std::regex_constants::error_escape);
+			}
+			set.set(static_cast<std::size_t>(byte));
+			return byte;
+		}
+
+		ByteSet characterClass()
+		{
+			pos_++;
+			bool negate = false;
+			if (more() && peek() == '^')
+			{
+				negate = true;
+				pos_++;
+			}
+
+			ByteSet set;
+			while (more() && peek() != ']')
+			{
+				int lo = member(set);
+				if (lo >= 0 && pos_ + 1 < pattern_.length() && peek() == '-' && pattern_[pos_ + 1] != ']')
+				{
+					pos_++;
+					ByteSet ignored;
+					int hi = member(ignored);
+					if (hi < 0)
+					{
+						throw std::regex_error(std::regex_constants::error_range);
+					}
+					if (hi < lo)
+					{
+						throw std::regex_error(std::regex_constants::error_range);
+					}
+					for (int c = lo; c <= hi; c++)
+					{
+						set.set(static_cast<std::size_t>(c));
+					}
+				}
+			}
+
+			if (!more())
+			{
+				throw std::regex_error(std::regex_constants::error_brack);
+			}
+			pos_++;
+
+			if (negate)
+			{
+				set.flip();
+			}
+			return set;
+		}
+
+		// Adds one class member to set; returns its byte, or -1 for \d and
+		// friends which cannot bound a range.
+		int member(ByteSet &set)
+		{
+			char c = peek();
+			if (c == '\\')
+			{
+				pos_++;
+				if (!more())
+				{
+					throw std::regex_error(std::regex_constants::error_escape);
+				}
+				return classEscape(set, true);
+			}
+			if (c == '[' && pos_ + 1 < pattern_.length() && (pattern_[pos_ + 1] == ':' || pattern_[pos_ + 1] == '=' || pattern_[pos_ + 1] == '.'))
+			{
+				// POSIX classes, equivalence classes and collating symbols.
+				throw Unsupported();
+			}
+			pos_++;
+			set.set(static_cast<unsigned char>(c));
+			return static_cast<unsigned char>(c);
+		}
+
+	private:
+		std::string_view pattern_;
+		std::size_t pos_ = 0;
+		std::size_t depth_ = 0;
+		std::vector<Ast> &nodes_;
+		std::vector<ByteSet> &sets_;
+	};
+
+	enum class Op : std::uint8_t
+	{
+		Byte,
+		Split,
+		Jump,
+		Begin,
+		End,
+		WordBoundary,
+		NotWordBoundary,
+		Match,
+	};
+
+	struct Inst
+	{
+		Op op;
+		std::uint32_t out;
+		std::uint32_t out1;
+		std::uint32_t set;
+	};
+
+	// Visited marks over instruction indexes, cleared in O(1) by bumping a
+	// generation counter.
+	struct Marks
+	{
+		std::vector<std::uint32_t> marks;
+		std::uint32_t generation = 0;
+
+		explicit Marks(std::size_t size) : marks(size, 0) {}
+
+		void clear()
+		{
+			if (++generation == 0)
+			{
+				std::fill(marks.begin(), marks.end(), 0);
+				generation = 1;
+			}
+		}
+
+		bool visit(std::uint32_t pc)
+		{
+			if (marks[pc] == generation)
+			{
+				return false;
+			}
+			marks[pc] = generation;
+			return true;
+		}
+	};
+
+	// Transition targets other than a state index.
+	enum : std::int32_t
+	{
+		kUnknown = -1,
+		kMatch = -2,
+		kFail = -3,
+	};
+
+	// Pseudo-byte for the end of the input.
+	static constexpr int kEnd = 256;
+} // namespace
+
+struct Regex::Program
+{
+	static constexpr std::size_t kMaxInsts = 1u << 14;
+	static constexpr std::size_t kMaxStates = 512;
+	// Nodes compiled, copies included. Bodies that emit nothing still count,
+	// so nested repetitions of them cannot run on below kMaxInsts.
+	static constexpr std::size_t kMaxSteps = 1u << 16;
+
+	std::vector<Inst> insts;
+	std::size_t steps = 0;
+	std::vector<ByteSet> sets;
+	std::uint32_t start = 0;
+	// Closure of start away from the beginning of the input, added at every
+	// position since searches are unanchored.
+	std::vector<std::uint32_t> restart;
+
+	// A DFA state is a set of NFA instructions reached at some position,
+	// each a Byte, Match or not yet decided assertion instruction.
+	struct State
+	{
+		std::vector<std::uint32_t> insts;
+		bool prevWord;
+		bool atBegin;
+		std::array<std::int32_t, 257> next;
+	};
+
+	mutable std::mutex mutex;
+	mutable std::vector<State> states;
+	mutable std::map<std::vector<std::uint32_t>, std::int32_t> index;
+
+	std::uint32_t emit(Op op, std::uint32_t out = 0, std::uint32_t out1 = 0, std::uint32_t set = 0)
+	{
+		if (insts.size() >= kMaxInsts)
+		{
+			throw Unsupported();
+		}
+		insts.push_back(Inst{op, out, out1, set});
+		return static_cast<std::uint32_t>(insts.size() - 1);
+	}
+
+	// Compiles node so that it continues at next; returns its entry point.
+	std::uint32_t compile(const std::vector<Ast> &nodes, std::size_t node, std::uint32_t next)
+	{
+		if (++steps > kMaxSteps)
+		{
+			throw std::regex_error(std::regex_constants::error_complexity);
+		}
+
+		const Ast &ast = nodes[node];
+		switch (ast.kind)
+		{
+		case Ast::Kind::Empty:
+			return next;
+		case Ast::Kind::Set:
+			return emit(Op::Byte, next, 0, static_cast<std::uint32_t>(ast.set));
+		case Ast::Kind::Concat:
+			for (auto it = ast.children.rbegin(); it != ast.children.rend(); ++it)
+			{
+				next = compile(nodes, *it, next);
+			}
+			return next;
+		case Ast::Kind::Alternate:
+		{
+			std::uint32_t entry = compile(nodes, ast.children.back(), next);
+			for (std::size_t i = ast.children.size() - 1; i-- > 0;)
+			{
+				std::uint32_t branch = compile(nodes, ast.children[i], next);
+				entry = emit(Op::Split, branch, entry);
+			}
+			return entry;
+		}
+		case Ast::Kind::Repeat:
+		{
+			std::uint32_t entry = next;
+			if (ast.max < 0)
+			{
+				std::uint32_t loop = emit(Op::Split, 0, next);
+				insts[loop].out = compile(nodes, ast.children.front(), loop);
+				entry = loop;
+			}
+			else
+			{
+				for (long i = ast.min; i < ast.max; i++)
+				{
+					std::uint32_t body = compile(nodes, ast.children.front(), entry);
+					entry = emit(Op::Split, body, next);
+				}
+			}
+			for (long i = 0; i < ast.min; i++)
+			{
+				entry = compile(nodes, ast.children.front(), entry);
+			}
+			return entry;
+		}
+		case Ast::Kind::Begin:
+			return emit(Op::Begin, next);
+		case Ast::Kind::End:
+			return emit(Op::End, next);
+		case Ast::Kind::WordBoundary:
+			return emit(Op::WordBoundary, next);
+		case Ast::Kind::NotWordBoundary:
+			return emit(Op::NotWordBoundary, next);
+		}
+		return next;
+	}
+
+	// Follows jumps and splits from pc, appending every instruction that
+	// waits for input or for an assertion to out. When next is known the
+	// assertions are decided instead of kept.
+	void closure(std::uint32_t pc, bool atBegin, bool prevWord, int next, Marks &marks, std::vector<std::uint32_t> &stack,
+				 std::vector<std::uint32_t> &out) const
+	{
+		stack.push_back(pc);
+		while (!stack.empty())
+		{
+			pc = stack.back();
+			stack.pop_back();
+			if (!marks.visit(pc))
+			{
+				continue;
+			}
+
+			const Inst &inst = insts[pc];
+			bool follow = false;
+			switch (inst.op)
+			{
+			case Op::Split:
+				stack.push_back(inst.out1);
+				follow = true;
+				break;
+			case Op::Jump:
+				follow = true;
+				break;
+			case Op::Begin:
+				follow = atBegin;
+				break;
+			case Op::End:
+			case Op::WordBoundary:
+			case Op::NotWordBoundary:
+				if (next == kUnknown)
+				{
+					out.push_back(pc);
+				}
+				else if (inst.op == Op::End)
+				{
+					follow = next == kEnd;
+				}
+				else
+				{
+					bool boundary = prevWord != isWordByte(next == kEnd ? -1 : next);
+					follow = boundary == (inst.op == Op::WordBoundary);
+				}
+				break;
+			case Op::Byte:
+			case Op::Match:
+				out.push_back(pc);
+				break;
+			}
+
+			if (follow)
+			{
+				stack.push_back(inst.out);
+			}
+		}
+	}
+
+	std::vector<std::uint32_t> initial() const
+	{
+		Marks marks(insts.size());
+		std::vector<std::uint32_t> stack;
+		std::vector<std::uint32_t> out;
+		marks.clear();
+		closure(start, true, false, kUnknown, marks, stack, out);
+		std::sort(out.begin(), out.end());
+		return out;
+	}
+
+	// Consumes next (a byte or kEnd) from a state. Returns kMatch, kFail or
+	// 0 with the following state's instructions in out.
+	std::int32_t step(const std::vector<std::uint32_t> &current, bool prevWord, bool atBegin, int next, Marks &marks,
+					  std::vector<std::uint32_t> &stack, std::vector<std::uint32_t> &resolved, std::vector<std::uint32_t> &out) const
+	{
+		resolved.clear();
+		marks.clear();
+		for (std::uint32_t pc : current)
+		{
+			closure(pc, atBegin, prevWord, next, marks, stack, resolved);
+		}
+
+		for (std::uint32_t pc : resolved)
+		{
+			if (insts[pc].op == Op::Match)
+			{
+				return kMatch;
+			}
+		}
+		if (next == kEnd)
+		{
+			return kFail;
+		}
+
+		out.clear();
+		marks.clear();
+		for (std::uint32_t pc : resolved)
+		{
+			const Inst &inst = insts[pc];
+			if (inst.op == Op::Byte && sets[inst.set].test(static_cast<std::size_t>(next)))
+			{
+				closure(inst.out, false, false, kUnknown, marks, stack, out);
+			}
+		}
+		for (std::uint32_t pc : restart)
+		{
+			if (marks.visit(pc))
+			{
+				out.push_back(pc);
+			}
+		}
+
+		if (out.empty())
+		{
+			return kFail;
+		}
+		std::sort(out.begin(), out.end());
+		return 0;
+	}
+
+	std::int32_t intern(std::vector<std::uint32_t> insts, bool prevWord, bool atBegin) const
+	{
+		std::vector<std::uint32_t> key(insts);
+		key.push_back(static_cast<std::uint32_t>(prevWord) | (static_cast<std::uint32_t>(atBegin) << 1));
+
+		auto it = index.find(key);
+		if (it != index.end())
+		{
+			return it->second;
+		}
+
+		State state{std::move(insts), prevWord, atBegin, {}};
+		state.next.fill(kUnknown);
+		states.push_back(std::move(state));
+		std::int32_t id = static_cast<std::int32_t>(states.size() - 1);
+		index.emplace(std::move(key), id);
+		return id;
+	}
+
+	// Runs over text caching every state and transition met. Must hold mutex.
+	bool runCached(std::string_view text) const
+	{
+		Marks marks(this->insts.size());
+		std::vector<std::uint32_t> stack;
+		std::vector<std::uint32_t> resolved;
+		std::vector<std::uint32_t> out;
+
+		if (states.empty())
+		{
+			intern(initial(), false, true);
+		}
+		std::int32_t current = 0;
+
+		for (std::size_t i = 0; i <= text.length(); i++)
+		{
+			int next = i < text.length() ? static_cast<unsigned char>(text[i]) : kEnd;
+			std::int32_t target = states[current].next[next];
+
+			if (target == kUnknown)
+			{
+				const State &state = states[current];
+				target = step(state.insts, state.prevWord, state.atBegin, next, marks, stack, resolved, out);
+				if (target == 0)
+				{
+					if (states.size() >= kMaxStates)
+					{
+						// Start over rather than grow without bound; the
+						// current state is the only one still needed.
+						State keep = std::move(states[current]);
+						states.clear();
+						index.clear();
+						intern(initial(), false, true);
+						current = intern(std::move(keep.insts), keep.prevWord, keep.atBegin);
+					}
+					target = intern(out, isWordByte(next), false);
+				}
+				states[current].next[next] = target;
+			}
+
+			if (target == kMatch)
+			{
+				return true;
+			}
+			if (target == kFail)
+			{
+				return false;
+			}
+			current = target;
+		}
+		return false;
+	}
+
+	// Same walk without touching the cache, for when another thread holds it.
+	bool runUncached(std::string_view text) const
+	{
+		Marks marks(this->insts.size());
+		std::vector<std::uint32_t> stack;
+		std::vector<std::uint32_t> resolved;
+		std::vector<std::uint32_t> current = initial();
+		std::vector<std::uint32_t> out;
+		bool prevWord = false;
+		bool atBegin = true;
+
+		for (std::size_t i = 0; i <= text.length(); i++)
+		{
+			int next = i < text.length() ? static_cast<unsigned char>(text[i]) : kEnd;
+			std::int32_t result = step(current, prevWord, atBegin, next, marks, stack, resolved, out);
+			if (result == kMatch)
+			{
+				return true;
+			}
+			if (result == kFail)
+			{
+				return false;
+			}
+			current.swap(out);
+			prevWord = isWordByte(next);
+			atBegin = false;
+		}
+		return false;
+	}
+};
+
+Regex::Regex(std::string_view pattern) : pattern_(pattern), literal_(RequiredLiteral(pattern))
+{
+	try
+	{
+		std::vector<Ast> nodes;
+		auto program = std::make_unique<Program>();
+		std::size_t root = PatternParser(pattern_, nodes, program->sets).Parse();
+
+		std::uint32_t match = program->emit(Op::Match);
+		program->start = program->compile(nodes, root, match);
+
+		Marks marks(program->insts.size());
+		std::vector<std::uint32_t> stack;
+		marks.clear();
+		program->closure(program->start, false, false, kUnknown, marks, stack, program->restart);
+
+		program_ = std::move(program);
+	}
+	catch (const Unsupported &)
+	{
+		if (!StdFallback())
+		{
+			throw std::regex_error(std::regex_constants::error_complexity);
+		}
+		fallback_ = std::make_unique<std::regex>(pattern_);
+	}
+}
+
+Regex::~Regex() = default;
+
+bool Regex::search(std::string_view text) const
+{
+	if (!literal_.empty() && text.find(literal_) == std::string_view::npos)
+	{
+		return false;
+	}
+	if (program_ == nullptr)
+	{
+		return std::regex_search(text.begin(), text.end(), *fallback_);
+	}
+
+	std::unique_lock<std::mutex> lock(program_->mutex, std::try_to_lock);
+	if (lock.owns_lock())
+	{
+		return program_->runCached(text);
+	}
+	return program_->runUncached(text);
+}
+
+void Regex::SetStdFallback(bool enabled)
+{
+	stdFallback.store(enabled, std::memory_order_relaxed);
+}
+
+bool Regex::StdFallback()
+{
+	return stdFallback.load(std::memory_order_relaxed);
+}
+
+std::string Regex::RequiredLiteral(std::string_view pattern)
+{
+	std::string best;
+	std::string run;
+	// Whether the last atom read is the last character of run, so that a
+	// quantifier allowing zero repetitions can take it back.
+	bool lastInRun = false;
+
+	auto flush = [&]()
+	{
+		if (run.length() > best.length())
+		{
+			best = run;
+		}
+		run.clear();
+		lastInRun = false;
+	};
+
+	auto quantified = [&](bool optional)
+	{
+		if (optional && lastInRun)
+		{
+			run.pop_back();
+		}
+		flush();
+	};
+
+	std::size_t i = 0;
+	while (i < pattern.length())
+	{
+		char c = pattern[i];
+		switch (c)
+		{
+		case '\\':
+			if (i + 1 < pattern.length() && !std::isalnum(static_cast<unsigned char>(pattern[i + 1])))
+			{
+				run += pattern[i + 1];
+				lastInRun = true;
+			}
+			else
+			{
+				flush();
+				i += escapeLength(pattern, i);
+				continue;
+			}
+			i += 2;
+			continue;
+		case '[':
+			flush();
+			i = skipClass(pattern, i);
+			continue;
+		case '(':
+			flush();
+			i = skipGroup(pattern, i);
+			continue;
+		case '|':
+			// Any branch may match on its own.
+			return std::string();
+		case '*':
+		case '?':
+			quantified(true);
+			break;
+		case '+':
+			quantified(false);
+			break;
+		case '{':
+		{
+			long min = 0;
+			long max = 0;
+			std::size_t end = readBraces(pattern, i, min, max);
+			if (end == i)
+			{
+				flush();
+				break;
+			}
+			quantified(min == 0);
+			i = end;
+			if (i < pattern.length() && pattern[i] == '?')
+			{
+				i++;
+			}
+			continue;
+		}
+		case '.':
+		case '^':
+		case '$':
+		case ')':
+			flush();
+			break;
+		default:
+			run += c;
+			lastInRun = true;
+			break;
+		}
+
+		i++;
+		// A lazy quantifier suffix does not repeat anything itself.
+		if ((c == '*' || c == '+' || c == '?') && i < pattern.length() && pattern[i] == '?')
+		{
+			i++;
+		}
+	}
+
+	flush();
+	return best;
+}
@@ -1,14 +1,18 @@
 #include "Selector.h"
 #include "Node.h"
+#include "MatchCursor.h"
+
+#include <algorithm>
 
 Selector::NodeSet Selector::Filter(NodeSet nodes) const
 {
 	NodeSet result;
+	result.reserve(nodes.size());
 	for (xmlNodePtr node : nodes)
 	{
 		if (matches(node))
 		{
-			result.insert(node);
+			result.push_back(node);
 		}
 	}
 	return result;
@@ -24,6 +28,72 @@ Selector::NodeSet Selector::MatchAll(xmlNodePtr node) const
 	matchAllInto(node, result);
 	return result;
 }
+
+Selector::NodeSet Selector::MatchAll(xmlNodePtr node, std::size_t limit) const
+{
+	NodeSet result;
+
+	if (node == nullptr || limit == 0)
+		return result;
+
+	ForEachMatch(node, [&result, limit](xmlNodePtr match)
+				 {
+		result.push_back(match);
+		return result.size() < limit; });
+	return result;
+}
+
+std::size_t Selector::CountMatches(xmlNodePtr node) const
+{
+	std::size_t count = 0;
+
+	ForEachMatch(node, [&count](xmlNodePtr)
+				 {
+		count++;
+		return true; });
+	return count;
+}
+std::vector<Selector::NodeSet> Selector::MatchMany(const std::vector<std::shared_ptr<Selector>> &selectors, xmlNodePtr node)
+{
+	std::vector<NodeSet> results(selectors.size());
+
+	if (node == nullptr)
+		return results;
+
+	MatchContext context;
+	std::vector<std::vector<std::uint32_t>> required(selectors.size());
+	bool keyed = false;
+
+	for (std::size_t i = 0; i < selectors.size(); i++)
+	{
+		context.useAncestorFilter = context.useAncestorFilter || selectors[i]->usesAncestorFilter();
+		selectors[i]->collectSubjectKeys(required[i]);
+		keyed = keyed || !required[i].empty();
+	}
+
+	std::vector<std::uint32_t> keys;
+	SubtreeWalk walk(node, context);
+
+	while (xmlNodePtr current = walk.next())
+	{
+		if (keyed)
+		{
+			keys.clear();
+			AncestorFilter::CollectKeys(current, keys);
+		}
+
+		for (std::size_t i = 0; i < selectors.size(); i++)
+		{
+			bool candidate = std::all_of(required[i].begin(), required[i].end(), [&keys](std::uint32_t key)
+										 { return std::find(keys.begin(), keys.end(), key) != keys.end(); });
+			if (candidate && selectors[i]->matches(current, context))
+			{
+				results[i].push_back(current);
+			}
+		}
+	}
+	return results;
+}
 /*
 void Selector::matchAllInto(xmlNodePtr node, NodeSet &nodes) const
 {
@@ -43,35 +113,26 @@ void Selector::matchAllInto(xmlNodePtr node, NodeSet &nodes) const
 	}
 }*/
 void Selector::matchAllInto(xmlNodePtr node, NodeSet &nodes) const
+{
+	ForEachMatch(node, [&nodes](xmlNodePtr match)
+				 {
+		nodes.push_back(match);
+		return true; });
+}
+
+void Selector::ForEachMatch(xmlNodePtr node, const std::function<bool(xmlNodePtr)> &visit) const
 {
 	if (node == nullptr)
 	{
 		return;
 	}
 
-	std::vector<xmlNodePtr> stack;
-	stack.reserve(256);
-	stack.push_back(node);
-
-	while (!stack.empty())
+	MatchCursor cursor(*this, node);
+	while (xmlNodePtr match = cursor.next())
 	{
-		xmlNodePtr current = stack.back();
-		stack.pop_back();
-
-		if (matches(current))
-		{
-			nodes.insert(current);
-		}
-
-		if (current->type == XML_ELEMENT_NODE)
+		if (!visit(match))
 		{
-			for (xmlNodePtr child = current->children; child != nullptr; child = child->next)
-			{
-				if (child->type == XML_ELEMENT_NODE)
-				{
-					stack.push_back(child);
-				}
-			}
+			return;
 		}
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,101 @@
+#include "SelectorCache.h"
+#include "Parser.h"
+
+SelectorCache &SelectorCache::Global()
+{
+	static SelectorCache cache;
+	return cache;
+}
+
+SelectorPtr SelectorCache::get(std::string_view selector, bool compile)
+{
+	Index &index = index_[compile ? 1 : 0];
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = index.find(selector);
+		if (it != index.end())
+		{
+			stats_.hits++;
+			entries_.splice(entries_.begin(), entries_, it->second);
+			return it->second->selector;
+		}
+		stats_.misses++;
+	}
+
+	// Parse outside the lock; a concurrent miss on the same text may parse it
+	// too, and the first one inserted wins.
+	SelectorPtr parsed = SelectorParser::Create(selector, compile);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (capacity_ == 0)
+	{
+		return parsed;
+	}
+
+	auto it = index.find(selector);
+	if (it != index.end())
+	{
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return it->second->selector;
+	}
+
+	entries_.push_front(Entry{std::string(selector), compile, parsed});
+	index.emplace(entries_.front().text, entries_.begin());
+	trim();
+	return parsed;
+}
+
+void SelectorCache::warm(const std::vector<std::string> &selectors, bool compile)
+{
+	for (const std::string &selector : selectors)
+	{
+		get(selector, compile);
+	}
+}
+
+void SelectorCache::setCapacity(std::size_t capacity)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	capacity_ = capacity;
+	trim();
+}
+
+std::size_t SelectorCache::getCapacity() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return capacity_;
+}
+
+void SelectorCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	index_[0].clear();
+	index_[1].clear();
+	entries_.clear();
+}
+
+SelectorCache::Stats SelectorCache::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	Stats stats = stats_;
+	stats.size = entries_.size();
+	stats.capacity = capacity_;
+	return stats;
+}
+
+void SelectorCache::resetStats()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	stats_ = Stats();
+}
+
+void SelectorCache::trim()
+{
+	while (entries_.size() > capacity_)
+	{
+		const Entry &oldest = entries_.back();
+		index_[oldest.compile ? 1 : 0].erase(oldest.text);
+		entries_.pop_back();
+		stats_.evictions++;
+	}
+}
@@ -0,0 +1,339 @@
+#include "SelectorOptimizer.h"
+
+#include "AttributeSelector.h"
+#include "BinarySelector.h"
+#include "CompiledSelector.h"
+#include "NarySelector.h"
+#include "TagSelector.h"
+#include "TextSelector.h"
+#include "UnarySelector.h"
+
+#include <algorithm>
+#include <typeinfo>
+#include <unordered_map>
+
+namespace
+{
+	static inline bool isUniversal(const SelectorPtr &selector)
+	{
+		return typeid(*selector) == typeid(Selector);
+	}
+
+	static inline bool isNever(const SelectorPtr &selector)
+	{
+		const auto *unary = dynamic_cast<const UnarySelector *>(selector.get());
+		return unary != nullptr && unary->getOperator() == UnarySelector::Operator::Not && isUniversal(unary->getSelector());
+	}
+
+	static inline SelectorPtr universal()
+	{
+		return std::make_shared<Selector>();
+	}
+
+	static inline SelectorPtr never()
+	{
+		return std::make_shared<UnarySelector>(UnarySelector::Operator::Not, universal());
+	}
+
+	static SelectorPtr optimize(const SelectorPtr &selector);
+
+	// Whether a and b are the same tree: nodes of the same kinds with the same
+	// operators, operands and flags. Their text is no substitute, since
+	// toString prints `#foo` and `[id=foo]` alike although only the second
+	// ignores case.
+	static bool sameSelector(const Selector &a, const Selector &b)
+	{
+		if (&a == &b)
+		{
+			return true;
+		}
+		if (typeid(a) != typeid(b))
+		{
+			return false;
+		}
+		if (typeid(a) == typeid(Selector))
+		{
+			return true;
+		}
+		if (const auto *attribute = dynamic_cast<const AttributeSelector *>(&a))
+		{
+			const auto &other = static_cast<const AttributeSelector &>(b);
+			return attribute->getOperator() == other.getOperator() && attribute->isCaseInsensitive() == other.isCaseInsensitive() && attribute->getKey() == other.getKey() && attribute->getValue() == other.getValue();
+		}
+		if (const auto *tag = dynamic_cast<const TagSelector *>(&a))
+		{
+			const auto &other = static_cast<const TagSelector &>(b);
+			return tag->getOperator() == other.getOperator() && tag->isOfType() == other.isOfType() && tag->getA() == other.getA() && tag->getB() == other.getB() && tag->isLast() == other.isLast() && tag->getRefValue() == other.getRefValue();
+		}
+		if (const auto *text = dynamic_cast<const TextSelector *>(&a))
+		{
+			const auto &other = static_cast<const TextSelector &>(b);
+			return text->getOperator() == other.getOperator() && text->getValue() == other.getValue();
+		}
+		if (const auto *unary = dynamic_cast<const UnarySelector *>(&a))
+		{
+			const auto &other = static_cast<const UnarySelector &>(b);
+			return unary->getOperator() == other.getOperator() && sameSelector(*unary->getSelector(), *other.getSelector());
+		}
+		if (const auto *binary = dynamic_cast<const BinarySelector *>(&a))
+		{
+			const auto &other = static_cast<const BinarySelector &>(b);
+			return binary->getOperator() == other.getOperator() && binary->isAdjacent() == other.isAdjacent() && sameSelector(*binary->getLeft(), *other.getLeft()) && sameSelector(*binary->getRight(), *other.getRight());
+		}
+		if (const auto *list = dynamic_cast<const NarySelector *>(&a))
+		{
+			const auto &other = static_cast<const NarySelector &>(b);
+			if (list->getOperator() != other.getOperator() || list->getSelectors().size() != other.getSelectors().size())
+			{
+				return false;
+			}
+			for (std::size_t i = 0; i < list->getSelectors().size(); i++)
+			{
+				if (!sameSelector(*list->getSelectors()[i], *other.getSelectors()[i]))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+		if (const auto *compiled = dynamic_cast<const CompiledSelector *>(&a))
+		{
+			return sameSelector(*compiled->getSource(), *static_cast<const CompiledSelector &>(b).getSource());
+		}
+		// Kinds this pass does not know are only the same as themselves.
+		return false;
+	}
+
+	// Operands of the chain of op rooted at selector, optimized, with nested
+	// chains of the same op spliced in. Walks left-deep chains without
+	// recursing, so long selector groups cannot exhaust the stack.
+	static void flatten(const SelectorPtr &selector, BinarySelector::Operator op, std::vector<SelectorPtr> &operands)
+	{
+		NarySelector::Operator nary = op == BinarySelector::Operator::Union ? NarySelector::Operator::Union : NarySelector::Operator::Intersection;
+
+		std::vector<SelectorPtr> pending{selector};
+		while (!pending.empty())
+		{
+			SelectorPtr current = pending.back();
+			pending.pop_back();
+
+			if (const auto *binary = dynamic_cast<const BinarySelector *>(current.get()); binary != nullptr && binary->getOperator() == op)
+			{
+				pending.push_back(binary->getRight());
+				pending.push_back(binary->getLeft());
+				continue;
+			}
+			if (const auto *list = dynamic_cast<const NarySelector *>(current.get()); list != nullptr && list->getOperator() == nary)
+			{
+				pending.insert(pending.end(), list->getSelectors().rbegin(), list->getSelectors().rend());
+				continue;
+			}
+
+			SelectorPtr optimized = optimize(current);
+			if (const auto *list = dynamic_cast<const NarySelector *>(optimized.get()); list != nullptr && list->getOperator() == nary)
+			{
+				operands.insert(operands.end(), list->getSelectors().begin(), list->getSelectors().end());
+			}
+			else
+			{
+				operands.push_back(optimized);
+			}
+		}
+	}
+
+	static SelectorPtr optimizeList(const SelectorPtr &selector, BinarySelector::Operator op)
+	{
+		bool isUnion = op == BinarySelector::Operator::Union;
+
+		std::vector<SelectorPtr> operands;
+		flatten(selector, op, operands);
+
+		std::vector<SelectorPtr> kept;
+		// Kept operands by text; equal trees print the same, so only those
+		// sharing an operand's text need comparing with it.
+		std::unordered_map<std::string, std::vector<const Selector *>> seen;
+		for (const SelectorPtr &operand : operands)
+		{
+			// `*` absorbs a union and is a no-op in a compound; a selector
+			// that never matches does the reverse.
+			if (isUniversal(operand))
+			{
+				if (isUnion)
+				{
+					return universal();
+				}
+				continue;
+			}
+			if (isNever(operand))
+			{
+				if (!isUnion)
+				{
+					return never();
+				}
+				continue;
+			}
+			std::vector<const Selector *> &alike = seen[operand->toString()];
+			if (std::none_of(alike.begin(), alike.end(), [&operand](const Selector *other)
+							 { return sameSelector(*operand, *other); }))
+			{
+				alike.push_back(operand.get());
+				kept.push_back(operand);
+			}
+		}
+
+		if (kept.empty())
+		{
+			return isUnion ? never() : universal();
+		}
+		if (kept.size() == 1)
+		{
+			return kept.front();
+		}
+
+		std::stable_sort(kept.begin(), kept.end(), [](const SelectorPtr &a, const SelectorPtr &b)
+						 { return SelectorOptimizer::CostOf(*a) < SelectorOptimizer::CostOf(*b); });
+		return std::make_shared<NarySelector>(isUnion ? NarySelector::Operator::Union : NarySelector::Operator::Intersection, std::move(kept));
+	}
+
+	static SelectorPtr optimize(const SelectorPtr &selector)
+	{
+		if (const auto *tag = dynamic_cast<const TagSelector *>(selector.get()))
+		{
+			return tag->getOperator() == TagSelector::Operator::Tag && tag->getAtom() == nullptr ? never() : selector;
+		}
+
+		if (const auto *unary = dynamic_cast<const UnarySelector *>(selector.get()))
+		{
+			SelectorPtr operand = optimize(unary->getSelector());
+			if (unary->getOperator() == UnarySelector::Operator::Not)
+			{
+				if (isUniversal(operand))
+				{
+					return never();
+				}
+				if (isNever(operand))
+				{
+					return universal();
+				}
+			}
+			else if (isNever(operand))
+			{
+				return never();
+			}
+			return operand == unary->getSelector() ? selector : std::make_shared<UnarySelector>(unary->getOperator(), operand);
+		}
+
+		if (const auto *list = dynamic_cast<const NarySelector *>(selector.get()))
+		{
+			return optimizeList(selector, list->getOperator() == NarySelector::Operator::Union ? BinarySelector::Operator::Union : BinarySelector::Operator::Intersection);
+		}
+
+		const auto *binary = dynamic_cast<const BinarySelector *>(selector.get());
+		if (binary == nullptr)
+		{
+			return selector;
+		}
+
+		switch (binary->getOperator())
+		{
+		case BinarySelector::Operator::Union:
+		case BinarySelector::Operator::Intersection:
+			return optimizeList(selector, binary->getOperator());
+		default:
+			break;
+		}
+
+		SelectorPtr left = optimize(binary->getLeft());
+		SelectorPtr right = optimize(binary->getRight());
+		if (isNever(left) || isNever(right))
+		{
+			return never();
+		}
+		if (left == binary->getLeft() && right == binary->getRight())
+		{
+			return selector;
+		}
+		if (binary->getOperator() == BinarySelector::Operator::Adjacent)
+		{
+			return std::make_shared<BinarySelector>(left, right, binary->isAdjacent());
+		}
+		return std::make_shared<BinarySelector>(binary->getOperator(), left, right);
+	}
+} // namespace
+
+SelectorPtr SelectorOptimizer::Optimize(const SelectorPtr &selector)
+{
+	if (selector == nullptr)
+	{
+		return selector;
+	}
+	// Compiled programs are built from their source and are left alone.
+	if (dynamic_cast<const CompiledSelector *>(selector.get()) != nullptr)
+	{
+		return selector;
+	}
+	return optimize(selector);
+}
+
+SelectorOptimizer::Cost SelectorOptimizer::CostOf(const Selector &selector)
+{
+	if (const auto *tag = dynamic_cast<const TagSelector *>(&selector))
+	{
+		return tag->getOperator() == TagSelector::Operator::Tag ? Tag : Structural;
+	}
+
+	if (const auto *attr = dynamic_cast<const AttributeSelector *>(&selector))
+	{
+		switch (attr->getOperator())
+		{
+		case AttributeSelector::Operator::Equals:
+			return attr->getKey() == "id" ? Id : Attribute;
+		case AttributeSelector::Operator::Includes:
+			return attr->getKey() == "class" ? Class : Attribute;
+		case AttributeSelector::Operator::Regex:
+			return Content;
+		default:
+			return Attribute;
+		}
+	}
+
+	if (dynamic_cast<const TextSelector *>(&selector) != nullptr)
+	{
+		return Content;
+	}
+
+	if (const auto *unary = dynamic_cast<const UnarySelector *>(&selector))
+	{
+		// :not() costs what its operand does; :has() searches a subtree.
+		return unary->getOperator() == UnarySelector::Operator::Not ? CostOf(*unary->getSelector()) : Content;
+	}
+
+	if (const auto *list = dynamic_cast<const NarySelector *>(&selector))
+	{
+		Cost cost = Universal;
+		for (const SelectorPtr &operand : list->getSelectors())
+		{
+			cost = std::max(cost, CostOf(*operand));
+		}
+		return cost;
+	}
+
+	if (const auto *binary = dynamic_cast<const BinarySelector *>(&selector))
+	{
+		switch (binary->getOperator())
+		{
+		case BinarySelector::Operator::Union:
+		case BinarySelector::Operator::Intersection:
+			return std::max(CostOf(*binary->getLeft()), CostOf(*binary->getRight()));
+		default:
+			return Combinator;
+		}
+	}
+
+	if (const auto *compiled = dynamic_cast<const CompiledSelector *>(&selector))
+	{
+		return CostOf(*compiled->getSource());
+	}
+
+	return typeid(selector) == typeid(Selector) ? Universal : Structural;
+}
@@ -0,0 +1,188 @@
+#include "SelectorSet.h"
+#include "BinarySelector.h"
+#include "CompiledSelector.h"
+#include "DocumentIndex.h"
+#include "MatchCursor.h"
+#include "NarySelector.h"
+#include "Parser.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Pushes the branches of a selector group onto branches, last first;
+	// returns false when selector is not a group.
+	static inline bool pushBranches(const Selector *selector, std::vector<const Selector *> &branches)
+	{
+		if (const auto *compiled = dynamic_cast<const CompiledSelector *>(selector))
+		{
+			selector = compiled->getSource().get();
+		}
+		if (const auto *binary = dynamic_cast<const BinarySelector *>(selector); binary != nullptr && binary->getOperator() == BinarySelector::Operator::Union)
+		{
+			branches.push_back(binary->getRight().get());
+			branches.push_back(binary->getLeft().get());
+			return true;
+		}
+		if (const auto *list = dynamic_cast<const NarySelector *>(selector); list != nullptr && list->getOperator() == NarySelector::Operator::Union)
+		{
+			for (auto it = list->getSelectors().rbegin(); it != list->getSelectors().rend(); ++it)
+			{
+				branches.push_back(it->get());
+			}
+			return true;
+		}
+		return false;
+	}
+} // namespace
+
+SelectorSet::RuleId SelectorSet::add(std::string_view selector)
+{
+	return insert(std::string(selector), SelectorParser::Create(selector));
+}
+
+SelectorSet::RuleId SelectorSet::add(SelectorPtr selector)
+{
+	std::string text = selector->toString();
+	return insert(std::move(text), std::move(selector));
+}
+
+SelectorSet::RuleId SelectorSet::insert(std::string text, SelectorPtr selector)
+{
+	RuleId rule = rules_.size();
+	const Rule &added = rules_.emplace_back(std::move(text), std::move(selector));
+	usesAncestorFilter_ = usesAncestorFilter_ || added.selector->usesAncestorFilter();
+
+	// Split groups without recursing, so long groups built through the API as
+	// left-deep union chains cannot exhaust the stack.
+	std::vector<const Selector *> branches{added.selector.get()};
+	while (!branches.empty())
+	{
+		const Selector *branch = branches.back();
+		branches.pop_back();
+
+		if (!pushBranches(branch, branches))
+		{
+			file(branch, rule);
+		}
+	}
+	return rule;
+}
+
+void SelectorSet::file(const Selector *branch, RuleId rule)
+{
+	DocumentIndex::SubjectKeys keys = DocumentIndex::GetSubjectKeys(*branch);
+	Entry entry{branch, rule};
+
+	if (keys.id != nullptr)
+	{
+		keyed_[AncestorFilter::IdKey(*keys.id)].push_back(entry);
+	}
+	else if (!keys.classes.empty())
+	{
+		keyed_[AncestorFilter::ClassKey(*keys.classes.front())].push_back(entry);
+	}
+	else if (keys.tag != nullptr)
+	{
+		keyed_[AncestorFilter::TagKey(*keys.tag)].push_back(entry);
+	}
+	else
+	{
+		universal_.push_back(entry);
+	}
+}
+
+void SelectorSet::collect(xmlNodePtr element, const MatchContext *context, std::vector<std::uint32_t> &keys, std::vector<RuleId> &rules) const
+{
+	std::size_t begin = rules.size();
+
+	auto test = [&](const std::vector<Entry> &entries)
+	{
+		for (const Entry &entry : entries)
+		{
+			if (context != nullptr ? entry.selector->matches(element, *context) : entry.selector->matches(element))
+			{
+				rules.push_back(entry.rule);
+			}
+		}
+	};
+
+	keys.clear();
+	AncestorFilter::CollectKeys(element, keys);
+	// A class token repeated within the attribute must not try its rules
+	// twice.
+	std::sort(keys.begin(), keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+	// Keys are hashes: a collision only tries extra rules, which the full
+	// match then rejects.
+	for (std::uint32_t key : keys)
+	{
+		auto it = keyed_.find(key);
+		if (it != keyed_.end())
+		{
+			test(it->second);
+		}
+	}
+	test(universal_);
+
+	// Several branches of one rule may match the same element.
+	std::sort(rules.begin() + begin, rules.end());
+	rules.erase(std::unique(rules.begin() + begin, rules.end()), rules.end());
+
+	for (std::size_t i = begin; i < rules.size(); i++)
+	{
+		rules_[rules[i]].hits.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+void SelectorSet::match(xmlNodePtr element, std::vector<RuleId> &rules) const
+{
+	if (element == nullptr || element->type != XML_ELEMENT_NODE)
+	{
+		return;
+	}
+
+	std::vector<std::uint32_t> keys;
+	collect(element, nullptr, keys, rules);
+}
+
+std::vector<SelectorSet::Match> SelectorSet::matchAll(xmlNodePtr scope) const
+{
+	std::vector<Match> matches;
+	if (scope == nullptr)
+	{
+		return matches;
+	}
+
+	MatchContext context;
+	context.useAncestorFilter = usesAncestorFilter_;
+	SubtreeWalk walk(scope, context);
+
+	std::vector<std::uint32_t> keys;
+	std::vector<RuleId> rules;
+
+	while (xmlNodePtr current = walk.next())
+	{
+		if (current->type != XML_ELEMENT_NODE)
+		{
+			continue;
+		}
+
+		rules.clear();
+		collect(current, &context, keys, rules);
+		for (RuleId rule : rules)
+		{
+			matches.push_back(Match{current, rule});
+		}
+	}
+	return matches;
+}
+
+void SelectorSet::resetHits()
+{
+	for (Rule &rule : rules_)
+	{
+		rule.hits.store(0, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,184 @@
+#include "StructuralJoin.h"
+#include "CompiledSelector.h"
+#include "DocumentIndex.h"
+#include "NarySelector.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace
+{
+	using ElementList = StructuralJoin::ElementList;
+
+	static inline const ElementInfo &infoOf(const DocumentIndex &index, xmlNodePtr element)
+	{
+		return *index.GetElementInfo(element);
+	}
+
+	static bool isCompound(const Selector *selector)
+	{
+		if (const auto *compiled = dynamic_cast<const CompiledSelector *>(selector))
+		{
+			selector = compiled->getSource().get();
+		}
+		if (const auto *binary = dynamic_cast<const BinarySelector *>(selector))
+		{
+			return binary->getOperator() == BinarySelector::Operator::Intersection && isCompound(binary->getLeft().get()) && isCompound(binary->getRight().get());
+		}
+		if (const auto *list = dynamic_cast<const NarySelector *>(selector))
+		{
+			if (list->getOperator() != NarySelector::Operator::Intersection)
+			{
+				return false;
+			}
+			for (const SelectorPtr &operand : list->getSelectors())
+			{
+				if (!isCompound(operand.get()))
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Elements of nodes for which keep accepts the innermost element of outer
+	// whose subtree strictly contains them.
+	template <typename Keep>
+	static ElementList nested(const DocumentIndex &index, const ElementList &outer, const ElementList &nodes, Keep keep)
+	{
+		ElementList result;
+		// Elements of outer whose subtrees contain the current position,
+		// outermost first.
+		std::vector<xmlNodePtr> open;
+		std::size_t next = 0;
+
+		auto close = [&index, &open](const ElementInfo &position)
+		{
+			while (!open.empty() && !infoOf(index, open.back()).contains(position))
+			{
+				open.pop_back();
+			}
+		};
+
+		for (xmlNodePtr node : nodes)
+		{
+			const ElementInfo &info = infoOf(index, node);
+			for (; next < outer.size() && infoOf(index, outer[next]).order < info.order; next++)
+			{
+				close(infoOf(index, outer[next]));
+				open.push_back(outer[next]);
+			}
+			close(info);
+			if (!open.empty() && keep(open.back(), node))
+			{
+				result.push_back(node);
+			}
+		}
+		return result;
+	}
+} // namespace
+
+bool StructuralJoin::Decompose(const Selector &selector, std::vector<Step> &steps)
+{
+	const Selector *current = &selector;
+	if (const auto *compiled = dynamic_cast<const CompiledSelector *>(current))
+	{
+		current = compiled->getSource().get();
+	}
+
+	std::vector<Step> reversed;
+	while (const auto *binary = dynamic_cast<const BinarySelector *>(current))
+	{
+		BinarySelector::Operator op = binary->getOperator();
+		if (op != BinarySelector::Operator::Child && op != BinarySelector::Operator::Descendant && op != BinarySelector::Operator::Adjacent)
+		{
+			break;
+		}
+		if (!isCompound(binary->getRight().get()))
+		{
+			return false;
+		}
+		reversed.push_back(Step{binary->getRight().get(), op, binary->isAdjacent()});
+		current = binary->getLeft().get();
+	}
+
+	if (reversed.empty() || !isCompound(current))
+	{
+		return false;
+	}
+	reversed.push_back(Step{current, BinarySelector::Operator::Descendant, false});
+
+	steps.assign(reversed.rbegin(), reversed.rend());
+	return true;
+}
+
+StructuralJoin::ElementList StructuralJoin::Join(const DocumentIndex &index, const ElementList &left, const ElementList &right, BinarySelector::Operator combinator, bool adjacent)
+{
+	switch (combinator)
+	{
+	case BinarySelector::Operator::Descendant:
+		return Descendants(index, left, right);
+	case BinarySelector::Operator::Child:
+		return Children(index, left, right);
+	case BinarySelector::Operator::Adjacent:
+		return adjacent ? NextSiblings(left, right) : FollowingSiblings(index, left, right);
+	default:
+		return ElementList();
+	}
+}
+
+StructuralJoin::ElementList StructuralJoin::Descendants(const DocumentIndex &index, const ElementList &ancestors, const ElementList &nodes)
+{
+	return nested(index, ancestors, nodes, [](xmlNodePtr, xmlNodePtr)
+				  { return true; });
+}
+
+StructuralJoin::ElementList StructuralJoin::Children(const DocumentIndex &index, const ElementList &parents, const ElementList &nodes)
+{
+	// A parent in the list is necessarily the innermost listed ancestor.
+	return nested(index, parents, nodes, [](xmlNodePtr ancestor, xmlNodePtr node)
+				  { return node->parent == ancestor; });
+}
+
+StructuralJoin::ElementList StructuralJoin::NextSiblings(const ElementList &siblings, const ElementList &nodes)
+{
+	std::unordered_set<xmlNodePtr> listed(siblings.begin(), siblings.end());
+
+	ElementList result;
+	for (xmlNodePtr node : nodes)
+	{
+		xmlNodePtr previous = node->prev;
+		while (previous != nullptr && previous->type != XML_ELEMENT_NODE)
+		{
+			previous = previous->prev;
+		}
+		if (previous != nullptr && listed.count(previous) != 0)
+		{
+			result.push_back(node);
+		}
+	}
+	return result;
+}
+
+StructuralJoin::ElementList StructuralJoin::FollowingSiblings(const DocumentIndex &index, const ElementList &siblings, const ElementList &nodes)
+{
+	// Earliest listed child of each parent; the list is in document order,
+	// so the first one seen.
+	std::unordered_map<xmlNodePtr, std::uint32_t> first;
+	for (xmlNodePtr sibling : siblings)
+	{
+		first.emplace(sibling->parent, infoOf(index, sibling).order);
+	}
+
+	ElementList result;
+	for (xmlNodePtr node : nodes)
+	{
+		auto it = first.find(node->parent);
+		if (it != first.end() && it->second < infoOf(index, node).order)
+		{
+			result.push_back(node);
+		}
+	}
+	return result;
+}
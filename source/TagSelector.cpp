@@ -6,6 +6,12 @@
 
 namespace
 {
+	static const NameAtom *const legendAtom = NameAtom::Intern("legend");
+	static const NameAtom *const fieldsetAtom = NameAtom::Intern("fieldset");
+	static const NameAtom *const inputAtom = NameAtom::Intern("input");
+	static const NameAtom *const menuitemAtom = NameAtom::Intern("menuitem");
+	static const NameAtom *const optionAtom = NameAtom::Intern("option");
+
 	static const std::unordered_map<std::string_view, bool> togglabe{
 		{"optgroup", true},
 		{"menuitem", true},
@@ -53,7 +59,7 @@ static inline bool hasLegendInPreviousSiblings(xmlNodePtr node)
 		{
 			continue;
 		}
-		if (IsEqualElement(cur, "legend"))
+		if (IsEqualElement(cur, legendAtom))
 		{
 			return true;
 		}
@@ -69,9 +75,9 @@ static inline bool inDisabledFieldset(xmlNodePtr node)
 		{
 			continue;
 		}
-		if ((IsEqualElement(cur->parent, "fieldset")) && (xmlHasProp(cur->parent, (const xmlChar *)"disabled") != nullptr))
+		if ((IsEqualElement(cur->parent, fieldsetAtom)) && (xmlHasProp(cur->parent, (const xmlChar *)"disabled") != nullptr))
 		{
-			if (IsEqualElement(cur, "legend") || hasLegendInPreviousSiblings(cur))
+			if (IsEqualElement(cur, legendAtom) || hasLegendInPreviousSiblings(cur))
 			{
 				return true;
 			}
@@ -87,7 +93,8 @@ static inline bool disabledMatch(xmlNodePtr node)
 		return false;
 	}
 
-	auto it = togglabe.find(getLowerElementName(node));
+	const NameAtom *atom = NameAtom::Of(node);
+	auto it = atom != nullptr ? togglabe.find(atom->str()) : togglabe.find(getLowerElementName(node));
 	if (it == togglabe.end())
 	{
 		return false;
@@ -112,7 +119,7 @@ static inline bool checkedMatch(xmlNodePtr node)
 		return false;
 	}
 
-	if (IsEqualElement(node, "input") || IsEqualElement(node, "menuitem"))
+	if (IsEqualElement(node, inputAtom) || IsEqualElement(node, menuitemAtom))
 	{
 		std::string type = GetAttributeValue(node, "type").value_or("");
 		if (type == "radio" || type == "checkbox")
@@ -120,13 +127,24 @@ static inline bool checkedMatch(xmlNodePtr node)
 			return xmlHasProp(node, (const xmlChar *)"checked") != nullptr;
 		}
 	}
-	else if (IsEqualElement(node, "option"))
+	else if (IsEqualElement(node, optionAtom))
 	{
 		return xmlHasProp(node, (const xmlChar *)"selected") != nullptr;
 	}
 	return false;
 }
 
+TagSelector::TagSelector(std::string_view tagname) : operator_(Operator::Tag), oftype_(false), a_(0), b_(0), last_(false), refvalue_(tagname)
+{
+	// Element names are compared lowercased, so a name with uppercase
+	// letters never matches.
+	if (std::none_of(refvalue_.begin(), refvalue_.end(), [](unsigned char c)
+					 { return std::isupper(c); }))
+	{
+		atom_ = NameAtom::Intern(refvalue_);
+	}
+}
+
 bool TagSelector::matches(xmlNodePtr node) const
 {
 	if (node == nullptr)
@@ -171,7 +189,7 @@ bool TagSelector::matches(xmlNodePtr node) const
 		return ((node_pos % a_) == 0) && ((node_pos / a_) >= 0);
 	}
 	case Operator::Tag:
-		return node->type == XML_ELEMENT_NODE && IsEqualElement(node, refvalue_);
+		return node->type == XML_ELEMENT_NODE && atom_ != nullptr && IsEqualElement(node, atom_);
 	case Operator::Root:
 		return xmlDocGetRootElement(node->doc) == node;
 	case Operator::Link:
@@ -192,6 +210,24 @@ bool TagSelector::matches(xmlNodePtr node) const
 	}
 }
 
+bool TagSelector::matches(xmlNodePtr node, const MatchContext &context) const
+{
+	// During a traversal the lang values of the ancestors are at hand.
+	if (operator_ == Operator::Lang && node != nullptr && node == context.current && node->type == XML_ELEMENT_NODE && !refvalue_.empty())
+	{
+		return context.langMatches(refvalue_);
+	}
+	return matches(node);
+}
+
+void TagSelector::collectSubjectKeys(std::vector<std::uint32_t> &keys) const
+{
+	if (operator_ == Operator::Tag)
+	{
+		keys.push_back(AncestorFilter::TagKey(refvalue_));
+	}
+}
+
 std::string TagSelector::toString() const
 {
 	std::stringstream ss;
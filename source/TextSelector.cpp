@@ -1,6 +1,154 @@
 #include "TextSelector.h"
 #include "Node.h"
 
+namespace
+{
+	// Feeds text through the whitespace normalization and ASCII lowercasing
+	// of :contains() and searches it for a needle incrementally, so text
+	// split over several nodes needs no copy.
+	class StreamingSearch
+	{
+	public:
+		StreamingSearch(std::string_view needle, const std::vector<std::size_t> &failure) : needle_(needle), failure_(failure) {}
+
+		// Returns true once the needle has been seen.
+		bool feed(const xmlChar *text)
+		{
+			if (text == nullptr)
+			{
+				return false;
+			}
+			for (const char *cur = reinterpret_cast<const char *>(text); *cur != '\0'; cur++)
+			{
+				char c = *cur;
+				if (std::isspace(static_cast<unsigned char>(c)))
+				{
+					// Runs collapse to one space, emitted only if more text follows.
+					pendingSpace_ = started_;
+					continue;
+				}
+				if (pendingSpace_)
+				{
+					pendingSpace_ = false;
+					if (push(' '))
+					{
+						return true;
+					}
+				}
+				started_ = true;
+				if (push(static_cast<char>(std::tolower(static_cast<unsigned char>(c)))))
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		bool push(char c)
+		{
+			while (matched_ > 0 && needle_[matched_] != c)
+			{
+				matched_ = failure_[matched_ - 1];
+			}
+			if (needle_[matched_] == c)
+			{
+				matched_++;
+			}
+			return matched_ == needle_.length();
+		}
+
+		std::string_view needle_;
+		const std::vector<std::size_t> &failure_;
+		std::size_t matched_ = 0;
+		bool started_ = false;
+		bool pendingSpace_ = false;
+	};
+
+	// Same text as xmlNodeGetContent(node) for an element, fed node by node.
+	static bool searchSubtreeText(xmlNodePtr node, StreamingSearch &search)
+	{
+		xmlNodePtr cur = node->children;
+		while (cur != nullptr)
+		{
+			switch (cur->type)
+			{
+			case XML_TEXT_NODE:
+			case XML_CDATA_SECTION_NODE:
+				if (search.feed(cur->content))
+				{
+					return true;
+				}
+				break;
+			case XML_ENTITY_REF_NODE:
+			{
+				xmlChar *content = xmlNodeGetContent(cur);
+				bool found = search.feed(content);
+				xmlFree(content);
+				if (found)
+				{
+					return true;
+				}
+				break;
+			}
+			default:
+				break;
+			}
+
+			if (cur->children != nullptr && cur->type != XML_ENTITY_REF_NODE)
+			{
+				cur = cur->children;
+				continue;
+			}
+			while (cur != node && cur->next == nullptr)
+			{
+				cur = cur->parent;
+			}
+			if (cur == node)
+			{
+				break;
+			}
+			cur = cur->next;
+		}
+		return false;
+	}
+
+	static bool searchOwnText(xmlNodePtr node, StreamingSearch &search)
+	{
+		for (xmlNodePtr child = node->children; child != nullptr; child = child->next)
+		{
+			if (child->type == XML_TEXT_NODE && search.feed(child->content))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+} // namespace
+
+TextSelector::TextSelector(Operator _operator, std::string_view value) : value_(value), operator_(_operator)
+{
+	if (operator_ == Operator::Matches || operator_ == Operator::MatchesOwn)
+	{
+		regex_ = std::make_shared<const Regex>(value_);
+		return;
+	}
+
+	failure_.assign(value_.length(), 0);
+	for (std::size_t i = 1, k = 0; i < value_.length(); i++)
+	{
+		while (k > 0 && value_[i] != value_[k])
+		{
+			k = failure_[k - 1];
+		}
+		if (value_[i] == value_[k])
+		{
+			k++;
+		}
+		failure_[i] = k;
+	}
+}
+
 bool TextSelector::matches(xmlNodePtr node) const
 {
 	if (!node)
@@ -9,27 +157,40 @@ bool TextSelector::matches(xmlNodePtr node) const
 	switch (operator_)
 	{
 	case Operator::Contains:
-		text = normalizeHtmlText(NodeText(node));
-		break;
+	{
+		if (value_.empty())
+		{
+			return true;
+		}
+		if (node->type != XML_ELEMENT_NODE)
+		{
+			return false;
+		}
+		StreamingSearch search(value_, failure_);
+		return searchSubtreeText(node, search);
+	}
 	case Operator::OwnContains:
-		text = normalizeHtmlText(NodeOwnText(node));
-		break;
+	{
+		if (value_.empty())
+		{
+			return true;
+		}
+		StreamingSearch search(value_, failure_);
+		return searchOwnText(node, search);
+	}
 	case Operator::Matches:
 	{
 		text = NodeText(node);
-		return std::regex_search(text, std::regex(value_));
+		return regex_->search(text);
 	}
 	case Operator::MatchesOwn:
 	{
 		text = NodeOwnText(node);
-		return std::regex_search(text, std::regex(value_));
+		return regex_->search(text);
 	}
 	default:
 		return false;
 	}
-
-	text = toLower(text);
-	return text.find(value_) != std::string::npos;
 }
 
 std::string TextSelector::toString() const
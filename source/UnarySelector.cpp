@@ -130,6 +130,51 @@ bool UnarySelector::matches(xmlNodePtr node) const
 	}
 }
 
+bool UnarySelector::matches(xmlNodePtr node, const MatchContext &context) const
+{
+	if (context.memo == nullptr || node == context.current)
+	{
+		return matchesWith(node, context);
+	}
+	int known = context.memo->find(this, node);
+	if (known >= 0)
+	{
+		return known != 0;
+	}
+	bool result = matchesWith(node, context);
+	context.memo->insert(this, node, result);
+	return result;
+}
+
+bool UnarySelector::matchesWith(xmlNodePtr node, const MatchContext &context) const
+{
+	// The ancestor filter describes this node's ancestors, so it only stays
+	// valid for :not(); :has() tests descendants and never passes it on.
+	if (operator_ == Operator::Not)
+	{
+		return !selector_->matches(node, context);
+	}
+	// :has-child() already tests each node once per traversal; :has() would
+	// search every candidate's subtree, so it is answered from marks instead.
+	if (operator_ != Operator::HasDescendant || !context.covers(node))
+	{
+		return matches(node);
+	}
+	if (node->type != XML_ELEMENT_NODE)
+	{
+		return false;
+	}
+
+	const auto &marks = context.hasMarks(this, [this](xmlNodePtr scope, NodeSet &found)
+										 { found = selector_->MatchAll(scope); });
+	return marks.count(node) != 0;
+}
+
+bool UnarySelector::usesAncestorFilter() const
+{
+	return operator_ == Operator::Not && selector_->usesAncestorFilter();
+}
+
 std::string UnarySelector::toString() const
 {
 	switch (operator_)
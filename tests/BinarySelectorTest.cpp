@@ -41,6 +41,23 @@ namespace lxml2query
         bool match_;
     };
 
+    class CountingName : public Selector
+    {
+    public:
+        CountingName(const std::string &match) : match_(match) {}
+        bool matches(xmlNodePtr node) const override
+        {
+            calls++;
+            return node->name != nullptr && std::string((char *)node->name) == match_;
+        }
+        std::string toString() const override { return match_; }
+
+        mutable std::size_t calls = 0;
+
+    private:
+        std::string match_;
+    };
+
     TEST(BinarySelectorTest, Union_TrueTrue)
     {
         auto lselector = std::make_shared<MockSelector>(true);
@@ -409,4 +426,133 @@ namespace lxml2query
 
         freeNode(node);
     }
-}
\ No newline at end of file
+
+    TEST(BinarySelectorTest, Descendant_MatchAllSeedsAncestorsAboveRoot)
+    {
+        xmlNodePtr node = createNode("<html><body class='x'><div><p><a/></p></div></body></html>");
+        xmlNodePtr div = node->children->children;
+
+        auto found = SelectorParser::Create(".x p a")->MatchAll(div);
+        ASSERT_EQ(found.size(), 1);
+        EXPECT_EQ(std::string((char *)found[0]->name), "a");
+
+        EXPECT_TRUE(SelectorParser::Create("div.y a")->MatchAll(div).empty());
+        freeNode(node);
+    }
+
+    TEST(BinarySelectorTest, Descendant_DeepNestingWithFilter)
+    {
+        std::string html = "<root>";
+        for (int i = 0; i < 60; i++)
+        {
+            html += (i == 20) ? "<div class='deep'>" : "<div>";
+        }
+        html += "<span/>";
+        for (int i = 0; i < 60; i++)
+        {
+            html += "</div>";
+        }
+        html += "<span/></root>";
+
+        xmlNodePtr node = createNode(html.c_str());
+
+        EXPECT_EQ(SelectorParser::Create("root div.deep div span")->MatchAll(node).size(), 1);
+        EXPECT_EQ(SelectorParser::Create("root > div span")->MatchAll(node).size(), 1);
+        EXPECT_EQ(SelectorParser::Create("root span")->MatchAll(node).size(), 2);
+        EXPECT_EQ(SelectorParser::Create("root span:not(div.deep span)")->MatchAll(node).size(), 1);
+        EXPECT_TRUE(SelectorParser::Create("root div.missing span")->MatchAll(node).empty());
+        freeNode(node);
+    }
+
+    TEST(BinarySelectorTest, GeneralSibling_TraversalTestsEachSiblingOnce)
+    {
+        std::string html = "<root><h2/>";
+        for (int i = 0; i < 1000; i++)
+        {
+            html += "<p/> ";
+        }
+        html += "<div><p/><h2/><p/></div></root>";
+        xmlNodePtr node = createNode(html.c_str());
+
+        auto lselector = std::make_shared<CountingName>("h2");
+        BinarySelector selector(lselector, std::make_shared<CountingName>("p"), false);
+
+        EXPECT_EQ(selector.MatchAll(node).size(), 1001);
+        EXPECT_LE(lselector->calls, 1003);
+
+        // Without a match to stop at, each p would otherwise test every
+        // sibling before it.
+        auto missing = std::make_shared<CountingName>("h3");
+        EXPECT_TRUE(BinarySelector(missing, std::make_shared<CountingName>("p"), false).MatchAll(node).empty());
+        EXPECT_LE(missing->calls, 1003);
+
+        // Outside a traversal, each candidate still walks its own siblings.
+        xmlNodePtr inner = node->last;
+        EXPECT_FALSE(selector.matches(inner->children));
+        EXPECT_TRUE(selector.matches(inner->last));
+        freeNode(node);
+    }
+
+    TEST(BinarySelectorTest, GeneralSibling_ContextAnswersOutOfOrder)
+    {
+        xmlNodePtr node = createNode("<root><p/><h2/><p/><p/></root>");
+        xmlNodePtr first = node->children;
+        xmlNodePtr last = node->last;
+
+        auto selector = SelectorParser::Create("h2 ~ p");
+        MatchContext context;
+        EXPECT_TRUE(selector->matches(last, context));
+        EXPECT_FALSE(selector->matches(first, context));
+        EXPECT_TRUE(selector->matches(last, context));
+        EXPECT_TRUE(selector->matches(last->prev, context));
+        freeNode(node);
+    }
+
+    TEST(BinarySelectorTest, Descendant_NestedChainTestsEachAncestorOnce)
+    {
+        // A chain of nested b, each with a c child.
+        std::string html = "<root>";
+        for (int i = 0; i < 200; i++)
+        {
+            html += "<b><c/>";
+        }
+        for (int i = 0; i < 200; i++)
+        {
+            html += "</b>";
+        }
+        html += "</root>";
+        xmlNodePtr node = createNode(html.c_str());
+
+        auto a = std::make_shared<CountingName>("a");
+        auto b = std::make_shared<CountingName>("b");
+        auto inner = std::make_shared<BinarySelector>(BinarySelector::Operator::Descendant, a, b);
+        BinarySelector selector(BinarySelector::Operator::Descendant, inner, std::make_shared<CountingName>("c"));
+
+        // Without shared results, every c tests `a b` on each of its
+        // ancestors, which tests a on each of theirs.
+        EXPECT_TRUE(selector.MatchAll(node).empty());
+        EXPECT_LE(a->calls, 500);
+        EXPECT_LE(b->calls, 500);
+
+        // Outside a traversal the answer is the same.
+        for (xmlNodePtr c = node->children->children; c != nullptr; c = c->next != nullptr ? c->next->children : nullptr)
+        {
+            EXPECT_FALSE(selector.matches(c));
+        }
+        freeNode(node);
+    }
+
+    TEST(BinarySelectorTest, Descendant_SharedResultsAgreeWithWalk)
+    {
+        xmlNodePtr node = createNode("<root><x><b><c/><d><c/></d></b></x><b><x><c/></x></b><a><b><b><c/></b></b></a></root>");
+
+        const char *selectors[] = {"x b c", "b c", "a b c", "x c", "root > b c", "x ~ b c", "b :not(x) c", ":has(c) c", "b b c", "a c + d c"};
+        for (const char *text : selectors)
+        {
+            SelectorPtr selector = SelectorParser::Create(text);
+            Selector all;
+            EXPECT_EQ(selector->MatchAll(node), selector->Filter(all.MatchAll(node))) << text;
+        }
+        freeNode(node);
+    }
+}
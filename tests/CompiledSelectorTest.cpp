@@ -0,0 +1,155 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    static inline std::size_t CountCompiled(xmlNodePtr root, const std::string &selector)
+    {
+        return SelectorParser::Create(selector, true)->MatchAll(root).size();
+    }
+
+    TEST(CompiledSelectorTest, DescendantBacktracking)
+    {
+        xmlNodePtr node = createNode("<a><b><c><b><d/></b></c></b><b><d/></b></a>");
+
+        EXPECT_EQ(CountCompiled(node, "a b c d"), 1);
+        EXPECT_EQ(CountCompiled(node, "a > b d"), 2);
+        EXPECT_EQ(CountCompiled(node, "c > b > d"), 1);
+        EXPECT_EQ(CountCompiled(node, "a > b > d"), 1);
+        EXPECT_EQ(CountCompiled(node, "c d, a > b > d"), 2);
+        freeNode(node);
+    }
+
+    TEST(CompiledSelectorTest, SiblingBacktracking)
+    {
+        xmlNodePtr node = createNode("<r><x/><y/><z/><y/><w/></r>");
+
+        EXPECT_EQ(CountCompiled(node, "x ~ y"), 2);
+        EXPECT_EQ(CountCompiled(node, "x + y"), 1);
+        EXPECT_EQ(CountCompiled(node, "x ~ z ~ w"), 1);
+        EXPECT_EQ(CountCompiled(node, "x + z ~ w"), 0);
+        EXPECT_EQ(CountCompiled(node, "y + z + y ~ w"), 1);
+        freeNode(node);
+    }
+
+    TEST(CompiledSelectorTest, NestedPseudoClasses)
+    {
+        xmlNodePtr node = createNode("<r><p class='a'><i/></p><p><b/></p><p class='a'/></r>");
+
+        EXPECT_EQ(CountCompiled(node, "p:has(i)"), 1);
+        EXPECT_EQ(CountCompiled(node, "p:has-child(b, i)"), 2);
+        EXPECT_EQ(CountCompiled(node, "p:not(.a)"), 1);
+        EXPECT_EQ(CountCompiled(node, "r :not(r > p.a)"), 3);
+        freeNode(node);
+    }
+
+    TEST(CompiledSelectorTest, ApiBuiltTreeFallsBackToSubPrograms)
+    {
+        xmlNodePtr node = createNode("<r><p><i/></p><q><i/></q></r>");
+
+        auto combinator = std::make_shared<BinarySelector>(BinarySelector::Operator::Child, std::make_shared<TagSelector>(std::string("q")), std::make_shared<TagSelector>(std::string("i")));
+        auto intersection = std::make_shared<BinarySelector>(BinarySelector::Operator::Intersection, combinator, std::make_shared<Selector>());
+        CompiledSelector compiled(intersection);
+
+        EXPECT_EQ(compiled.MatchAll(node).size(), 1);
+        EXPECT_EQ(compiled.toString(), intersection->toString());
+        EXPECT_NE(compiled.disassemble().find("sub"), std::string::npos);
+        freeNode(node);
+    }
+
+    TEST(CompiledSelectorTest, TagCompareIsNonVirtual)
+    {
+        CompiledSelector compiled(SelectorParser::Create("div span"));
+        std::string code = compiled.disassemble();
+
+        EXPECT_NE(code.find("tag span"), std::string::npos);
+        EXPECT_NE(code.find("ancestor"), std::string::npos);
+        EXPECT_NE(code.find("tag div"), std::string::npos);
+        EXPECT_EQ(code.find("call"), std::string::npos);
+    }
+
+    static std::string adaptiveXml()
+    {
+        // Mostly spans, and very few of them priced.
+        std::string row = "<p>";
+        for (int i = 0; i < 10; i++)
+        {
+            row += "<span>y</span>";
+        }
+        row += "<b class='price'/></p>";
+
+        std::string xml = "<r>";
+        for (int i = 0; i < 300; i++)
+        {
+            xml += i % 50 == 0 ? "<p><span class='price'>x</span></p>" : row;
+        }
+        return xml + "</r>";
+    }
+
+    TEST(CompiledSelectorTest, AdaptiveAgreesWithSource)
+    {
+        xmlNodePtr node = createNode(adaptiveXml().c_str());
+
+        for (const char *selector : {"span.price", "p > span:first-child.price", "p:has(b).x, span:not(.price)", "r p span:contains(x)[class]"})
+        {
+            SelectorPtr source = SelectorParser::Create(selector, false, true);
+            CompiledSelector adaptive(source, true);
+            EXPECT_TRUE(adaptive.isAdaptive());
+
+            NodeSet expected = source->MatchAll(node);
+            for (int round = 0; round < 8; round++)
+            {
+                EXPECT_EQ(adaptive.MatchAll(node), expected) << selector;
+            }
+        }
+        freeNode(node);
+    }
+
+    TEST(CompiledSelectorTest, AdaptiveMovesRejectingTestsFirst)
+    {
+        xmlNodePtr node = createNode(adaptiveXml().c_str());
+
+        CompiledSelector adaptive(SelectorParser::Create("span.price", false, true), true);
+        EXPECT_NE(adaptive.disassemble().find("group 0:\n  0: tag span\n  1: attr"), std::string::npos);
+
+        for (int round = 0; round < 4; round++)
+        {
+            adaptive.MatchAll(node);
+        }
+
+        std::vector<std::vector<CompiledSelector::PredicateStats>> stats = adaptive.getStats();
+        ASSERT_EQ(stats.size(), 1);
+        ASSERT_EQ(stats[0].size(), 2);
+        EXPECT_EQ(stats[0][0].predicate, "span");
+        EXPECT_EQ(stats[0][1].predicate, ".price");
+        EXPECT_LT(stats[0][1].passed * 10, stats[0][1].tested);
+        EXPECT_NE(adaptive.disassemble().find("group 0:\n  1: attr"), std::string::npos);
+
+        EXPECT_TRUE(CompiledSelector(SelectorParser::Create("span.price")).getStats().empty());
+        freeNode(node);
+    }
+
+    TEST(CompiledSelectorTest, AdaptiveStatsRoundTrip)
+    {
+        xmlNodePtr node = createNode(adaptiveXml().c_str());
+
+        SelectorPtr source = SelectorParser::Create("p > span.price:first-child", false, true);
+        CompiledSelector warmed(source, true);
+        for (int round = 0; round < 4; round++)
+        {
+            warmed.MatchAll(node);
+        }
+        std::string exported = warmed.exportStats();
+
+        CompiledSelector restored(SelectorParser::Create("p > span.price:first-child", false, true), true);
+        ASSERT_TRUE(restored.importStats(exported));
+        EXPECT_EQ(restored.disassemble(), warmed.disassemble());
+        EXPECT_EQ(restored.exportStats(), exported);
+
+        CompiledSelector other(SelectorParser::Create("p > span.sale", false, true), true);
+        EXPECT_FALSE(other.importStats(exported));
+        EXPECT_FALSE(restored.importStats("garbage"));
+        EXPECT_EQ(restored.exportStats(), exported);
+        freeNode(node);
+    }
+}
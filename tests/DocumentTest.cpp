@@ -75,4 +75,226 @@ namespace lxml2query
 		ASSERT_TRUE(doc.parseMemory(large_html.str()));
 		ASSERT_TRUE(doc.isValid());
 	}
-} // namespace lxml2query
\ No newline at end of file
+
+	TEST(DocumentTest, IdIndex_DuplicateIdsInDocumentOrder)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<div id='a'><p id='b'>1</p></div><p id='a'>2</p>"));
+		ASSERT_NE(doc.getIndex(), nullptr);
+
+		auto &ids = doc.getIndex()->GetElementsById("a");
+		ASSERT_EQ(ids.size(), 2);
+		EXPECT_EQ(std::string((char *)ids[0]->name), "div");
+		EXPECT_EQ(std::string((char *)ids[1]->name), "p");
+		EXPECT_TRUE(doc.getIndex()->GetElementsById("missing").empty());
+
+		EXPECT_EQ(doc.Find("#a").size(), 2);
+		EXPECT_EQ(doc.Find("p#a").size(), 1);
+		EXPECT_EQ(doc.Find("div > #b").size(), 1);
+		EXPECT_EQ(doc.Find("#b, #a").size(), 3);
+		EXPECT_TRUE(doc.Find("#missing").empty());
+	}
+
+	TEST(DocumentTest, IdIndex_AnchoredScope)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<div id='main'><p class='item'>1</p><div><p class='item'>2</p></div></div><p class='item'>3</p>"));
+
+		auto found = doc.Find("#main .item");
+		ASSERT_EQ(found.size(), 2);
+		EXPECT_EQ(found[0].value().Text(), "1");
+		EXPECT_EQ(found[1].value().Text(), "2");
+
+		EXPECT_EQ(doc.Find("#main > .item").size(), 1);
+		EXPECT_EQ(doc.Find("#main div .item").size(), 1);
+		EXPECT_EQ(doc.Find(".item").size(), 3);
+	}
+
+	TEST(DocumentTest, IdIndex_NodeFindStaysInScope)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<div id='x'><span id='s'>1</span></div><div id='y'><b class='k'/></div>"));
+
+		Node x = doc.Find("#x").front();
+		Node y = doc.Find("#y").front();
+
+		EXPECT_EQ(x.Find("#s").size(), 1);
+		EXPECT_TRUE(y.Find("#s").empty());
+		EXPECT_EQ(y.Find("#y .k").size(), 1);
+		EXPECT_TRUE(x.Find("#y .k").empty());
+		EXPECT_EQ(y.Find("#y").size(), 1);
+	}
+
+	TEST(DocumentTest, PostingLists_TagAndClass)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<table class='prices'><tr><TD class='a b a'>1</TD><td class='b'>2</td></tr></table><td>3</td>"));
+
+		auto &tds = doc.getIndex()->GetElementsByTagName("td");
+		ASSERT_EQ(tds.size(), 3);
+		EXPECT_EQ(Node(tds[0]).Text(), "1");
+		EXPECT_EQ(doc.getIndex()->GetElementsByClassName("a").size(), 1);
+		EXPECT_EQ(doc.getIndex()->GetElementsByClassName("b").size(), 2);
+		EXPECT_TRUE(doc.getIndex()->GetElementsByTagName("TD").empty());
+
+		EXPECT_EQ(doc.Find("table.prices td").size(), 2);
+		EXPECT_EQ(doc.Find("td.b").size(), 2);
+		EXPECT_EQ(doc.Find("tr > td.a.b").size(), 1);
+		EXPECT_EQ(doc.Find("td").size(), 3);
+		EXPECT_EQ(doc.Find("td, .prices").size(), 4);
+		EXPECT_TRUE(doc.Find("TD").empty());
+	}
+
+	TEST(DocumentTest, FindFirstExistsCount)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<div id='a'><p>1</p><p class='x'>2</p></div><div id='b'><p class='x'>3</p><span>4</span></div>"));
+
+		// Index paths (id, tag, class, union, anchor) and a plain scan.
+		const char *selectors[] = {"#b", "p", ".x", "span, .x", "#b p", "div > p:last-child", "p:contains('3')", "ul"};
+		for (const char *selector : selectors)
+		{
+			QueryResult all = doc.Find(selector);
+			EXPECT_EQ(doc.Count(selector), all.size()) << selector;
+			EXPECT_EQ(doc.Exists(selector), !all.empty()) << selector;
+
+			auto first = doc.FindFirst(selector);
+			ASSERT_EQ(first.has_value(), !all.empty()) << selector;
+			if (first.has_value())
+			{
+				EXPECT_EQ(first.value()(), all.front()()) << selector;
+			}
+
+			for (std::size_t limit = 0; limit <= all.size() + 1; limit++)
+			{
+				QueryResult limited = doc.Find(selector, limit);
+				ASSERT_EQ(limited.size(), std::min(limit, all.size())) << selector;
+				for (std::size_t i = 0; i < limited.size(); i++)
+				{
+					EXPECT_EQ(limited[i]->operator()(), all[i]->operator()()) << selector;
+				}
+			}
+		}
+
+		Node second = doc.FindFirst("#b").value();
+		EXPECT_EQ(second.FindFirst("p")->Text(), "3");
+		EXPECT_EQ(second.Count("*"), 3);
+		EXPECT_FALSE(second.Exists("div > p:first-child:not(.x)"));
+	}
+
+	TEST(DocumentTest, FindMany_MatchesFindPerSelector)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<div id='a' class='x'><p>1</p><p class='x y'>2</p></div><ul><li class='y'><a href='#'>3</a></li><li>4</li></ul>"));
+
+		const std::vector<std::string> selectors = {"#a", "p", ".x", "div p.y", "li:last-child", "ul > li a[href]", "p, li", "*", ":contains('2')", "div:has(.y)", "nope"};
+		std::vector<QueryResult> results = doc.FindMany(selectors);
+
+		ASSERT_EQ(results.size(), selectors.size());
+		for (std::size_t i = 0; i < selectors.size(); i++)
+		{
+			EXPECT_EQ(results[i].toVector().size(), doc.Find(selectors[i]).size()) << selectors[i];
+			for (std::size_t j = 0; j < results[i].size(); j++)
+			{
+				EXPECT_EQ(results[i][j]->operator()(), doc.Find(selectors[i])[j]->operator()()) << selectors[i];
+			}
+		}
+
+		// The shared walk on its own, without the index.
+		std::vector<SelectorPtr> parsed;
+		for (const std::string &selector : selectors)
+		{
+			parsed.push_back(SelectorParser::Create(selector));
+		}
+		std::vector<NodeSet> scanned = Selector::MatchMany(parsed, doc.getRoot());
+		for (std::size_t i = 0; i < selectors.size(); i++)
+		{
+			EXPECT_EQ(scanned[i], parsed[i]->MatchAll(doc.getRoot())) << selectors[i];
+		}
+	}
+
+	TEST(DocumentTest, Index_LeavesPrivateSlotsAlone)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<div id='a' class='x'><p>1</p><p class='x'>2</p></div>"));
+
+		xmlNodePtr root = doc.getRoot();
+		EXPECT_EQ(root->doc->_private, nullptr);
+		for (xmlNodePtr element : doc.getIndex()->GetElements())
+		{
+			EXPECT_EQ(element->_private, nullptr);
+		}
+
+		// Whatever the application keeps there is never read.
+		int marker = 0;
+		root->doc->_private = &marker;
+		for (xmlNodePtr element : doc.getIndex()->GetElements())
+		{
+			element->_private = &marker;
+		}
+		EXPECT_EQ(doc.Find("#a .x").size(), 1);
+		EXPECT_EQ(doc.Find("p:first-child").size(), 1);
+		EXPECT_NE(ElementInfo::Of(root), nullptr);
+		root->doc->_private = nullptr;
+
+		// Nor on documents the library did not parse.
+		const std::string html = "<div><p>1</p><p>2</p></div>";
+		xmlDocPtr plain = htmlReadMemory(html.c_str(), static_cast<int>(html.length()), nullptr, "UTF-8", HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING);
+		ASSERT_NE(plain, nullptr);
+		plain->_private = &marker;
+		xmlDocGetRootElement(plain)->_private = &marker;
+		EXPECT_EQ(DocumentIndex::FromNode(xmlDocGetRootElement(plain)), nullptr);
+		EXPECT_EQ(QueryResult::Find(xmlDocGetRootElement(plain), "p:last-child").size(), 1);
+		xmlFreeDoc(plain);
+	}
+
+	TEST(DocumentTest, Index_MovedNodesLeaveTheirIndex)
+	{
+		Document target;
+		ASSERT_TRUE(target.parseMemory("<div id='t'></div>"));
+
+		xmlNodePtr moved = nullptr;
+		{
+			Document source;
+			ASSERT_TRUE(source.parseMemory("<section><p class='m'><b>1</b></p></section>"));
+			moved = source.Find(".m").front();
+			ASSERT_NE(ElementInfo::Of(moved), nullptr);
+
+			xmlUnlinkNode(moved);
+			xmlAddChild(target.Find("#t").front(), moved);
+		}
+
+		// The source index is gone, and the target one never saw the node.
+		EXPECT_EQ(ElementInfo::Of(moved), nullptr);
+		EXPECT_EQ(ElementInfo::Of(moved->children), nullptr);
+		EXPECT_EQ(SelectorParser::Create("p > b:only-child")->MatchAll(moved).size(), 1);
+
+		target.Reindex();
+		EXPECT_NE(ElementInfo::Of(moved), nullptr);
+		EXPECT_EQ(target.Find("#t > .m b").size(), 1);
+	}
+
+	TEST(DocumentTest, Index_ReindexAfterChanges)
+	{
+		Document doc;
+		ASSERT_TRUE(doc.parseMemory("<ul id='list'><li class='a'>1</li><li class='b'>2</li><li class='a'>3</li></ul>"));
+		ASSERT_EQ(doc.Find(".a").size(), 2);
+
+		xmlNodePtr removed = doc.Find(".a").front();
+		xmlUnlinkNode(removed);
+		xmlFreeNode(removed);
+		xmlNodePtr added = xmlNewChild(doc.Find("#list").front(), nullptr, BAD_CAST "li", BAD_CAST "4");
+		xmlNewProp(added, BAD_CAST "class", BAD_CAST "a");
+		doc.Reindex();
+
+		EXPECT_EQ(doc.getIndex()->ElementCount(), 6u);
+		QueryResult found = doc.Find(".a");
+		ASSERT_EQ(found.size(), 2);
+		EXPECT_EQ(found[0]->Text(), "3");
+		EXPECT_EQ(found[1]->Text(), "4");
+		EXPECT_EQ(doc.Count("li"), 3);
+		EXPECT_EQ(doc.FindFirst("li:first-child")->Text(), "2");
+		EXPECT_EQ(doc.Find("#list > .b + .a").size(), 1);
+		EXPECT_EQ(ElementInfo::Of(added)->position, 3u);
+	}
+} // namespace lxml2query
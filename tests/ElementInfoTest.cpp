@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    static const char *siblingsHtml = "<ul><li></li><p></p><li></li>text<li></li><p></p><!-- c --><li></li></ul>";
+
+    TEST(ElementInfoTest, IndexedElementsCarryPositions)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(siblingsHtml));
+
+        QueryResult items = doc.Find("ul > *");
+        ASSERT_EQ(items.size(), 6);
+
+        const unsigned int positions[] = {1, 2, 3, 4, 5, 6};
+        const unsigned int typePositions[] = {1, 1, 2, 3, 2, 4};
+        const unsigned int typeSiblings[] = {4, 2, 4, 4, 2, 4};
+        for (std::size_t i = 0; i < items.size(); i++)
+        {
+            const ElementInfo *info = ElementInfo::Of(*items[i]);
+            ASSERT_NE(info, nullptr);
+            EXPECT_EQ(info->position, positions[i]);
+            EXPECT_EQ(info->siblings, 6);
+            EXPECT_EQ(info->typePosition, typePositions[i]);
+            EXPECT_EQ(info->typeSiblings, typeSiblings[i]);
+        }
+    }
+
+    TEST(ElementInfoTest, UnindexedElementsHaveNoInfo)
+    {
+        xmlNodePtr node = createNode("<ul><li/><p/></ul>");
+
+        EXPECT_EQ(ElementInfo::Of(node), nullptr);
+        EXPECT_EQ(ElementInfo::Of(node->children), nullptr);
+        freeNode(node);
+    }
+
+    TEST(ElementInfoTest, IndexedAndUnindexedAgree)
+    {
+        const std::string html = "<div><p></p><span></span><p><b></b></p><span></span><p></p><i></i><p></p></div>";
+        const char *selectors[] = {
+            "p:nth-child(2n+1)", "p:nth-of-type(2)", "span:nth-last-child(3)", "p:nth-last-of-type(1)",
+            "b:only-child", "i:only-of-type", "span:first-of-type", "*:last-child", "div:only-child", "p:last-of-type",
+        };
+
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(html));
+        xmlDocPtr plain = htmlReadMemory(html.c_str(), static_cast<int>(html.length()), nullptr, "UTF-8",
+                                         HTML_PARSE_NOBLANKS | HTML_PARSE_NOERROR | HTML_PARSE_NOWARNING);
+        ASSERT_NE(plain, nullptr);
+
+        for (const char *selector : selectors)
+        {
+            SelectorPtr compiled = SelectorParser::Create(selector);
+            EXPECT_EQ(doc.Find(compiled).size(), compiled->MatchAll(xmlDocGetRootElement(plain)).size()) << selector;
+        }
+        xmlFreeDoc(plain);
+    }
+}
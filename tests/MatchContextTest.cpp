@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    TEST(AncestorFilterTest, PushAndPop)
+    {
+        xmlNodePtr node = createNode("<div id='main' class='a  b'><p>Test</p></div>");
+        AncestorFilter filter;
+
+        filter.push(node);
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::TagKey("div")));
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::TagKey("DIV")));
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::IdKey("main")));
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::ClassKey("a")));
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::ClassKey("b")));
+        EXPECT_FALSE(filter.mayContain(AncestorFilter::TagKey("span")));
+
+        filter.push(node->children);
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::TagKey("p")));
+
+        filter.pop();
+        EXPECT_FALSE(filter.mayContain(AncestorFilter::TagKey("p")));
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::TagKey("div")));
+
+        filter.pop();
+        EXPECT_FALSE(filter.mayContain(AncestorFilter::TagKey("div")));
+        EXPECT_FALSE(filter.mayContain(AncestorFilter::IdKey("main")));
+        freeNode(node);
+    }
+
+    TEST(AncestorFilterTest, KeysAreKindSpecific)
+    {
+        xmlNodePtr node = createNode("<div class='main'/>");
+        AncestorFilter filter;
+
+        filter.push(node);
+        EXPECT_TRUE(filter.mayContain(AncestorFilter::ClassKey("main")));
+        EXPECT_FALSE(filter.mayContain(AncestorFilter::IdKey("main")));
+        EXPECT_FALSE(filter.mayContain(AncestorFilter::TagKey("main")));
+        freeNode(node);
+    }
+
+    TEST(MatchMemoTest, FindInsertReset)
+    {
+        xmlNodePtr node = createNode("<div><p/><p/></div>");
+        int keys[2];
+
+        MatchMemo memo;
+        EXPECT_EQ(memo.size(), 0);
+        EXPECT_EQ(memo.find(&keys[0], node), -1);
+
+        memo.insert(&keys[0], node, true);
+        memo.insert(&keys[1], node, false);
+        memo.insert(&keys[0], node->children, false);
+        EXPECT_EQ(memo.find(&keys[0], node), 1);
+        EXPECT_EQ(memo.find(&keys[1], node), 0);
+        EXPECT_EQ(memo.find(&keys[0], node->children), 0);
+        EXPECT_EQ(memo.find(&keys[1], node->children), -1);
+        EXPECT_EQ(memo.size(), 3);
+
+        memo.reset();
+        EXPECT_EQ(memo.size(), 0);
+        EXPECT_EQ(memo.find(&keys[0], node), -1);
+        freeNode(node);
+    }
+
+    TEST(MatchMemoTest, Grows)
+    {
+        std::vector<int> keys(5000);
+        xmlNodePtr node = createNode("<div/>");
+
+        MatchMemo memo;
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            memo.insert(&keys[i], node, i % 3 == 0);
+        }
+        EXPECT_EQ(memo.size(), keys.size());
+        for (std::size_t i = 0; i < keys.size(); i++)
+        {
+            EXPECT_EQ(memo.find(&keys[i], node), i % 3 == 0 ? 1 : 0);
+        }
+        EXPECT_EQ(MatchMemo().find(&keys[0], node), -1);
+        freeNode(node);
+    }
+
+    TEST(MatchMemoTest, ResetReleasesLargeTables)
+    {
+        xmlNodePtr node = createNode("<div/>");
+        MatchMemo memo;
+        EXPECT_EQ(memo.capacity(), 0);
+
+        // A small table is kept for the next traversal.
+        int key;
+        memo.insert(&key, node, true);
+        std::size_t small = memo.capacity();
+        memo.reset();
+        EXPECT_EQ(memo.capacity(), small);
+        EXPECT_EQ(memo.find(&key, node), -1);
+
+        std::vector<int> keys(MatchMemo::kRetainedSlots);
+        for (int &each : keys)
+        {
+            memo.insert(&each, node, true);
+        }
+        EXPECT_GT(memo.capacity(), MatchMemo::kRetainedSlots);
+        memo.reset();
+        EXPECT_EQ(memo.capacity(), 0);
+        EXPECT_EQ(memo.find(&keys[0], node), -1);
+
+        memo.insert(&keys[0], node, false);
+        EXPECT_EQ(memo.find(&keys[0], node), 0);
+        freeNode(node);
+    }
+}
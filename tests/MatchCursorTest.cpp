@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+#include <thread>
+
+namespace lxml2query
+{
+    static const char *cursorXml =
+        "<html><body><div id='a' class='x'><p>1</p><p class='x'>2<b>b</b></p></div>"
+        "<ul><li><div class='x'><span>3</span></div></li><li/></ul><p>4</p></body></html>";
+
+    TEST(MatchCursorTest, AgreesWithMatchAll)
+    {
+        xmlNodePtr root = createNode(cursorXml);
+        xmlNodePtr body = root->children;
+        const char *selectors[] = {"*", "p", ".x", "div p", "body > p", "ul li span", "li:last-child", "div:has(b)", "p + ul", "ul"};
+
+        for (xmlNodePtr scope : {root, body, body->children, body->children->next})
+        {
+            for (const char *selector : selectors)
+            {
+                SelectorPtr parsed = SelectorParser::Create(selector);
+                NodeSet expected = parsed->MatchAll(scope);
+
+                MatchCursor cursor(*parsed, scope);
+                std::vector<xmlNodePtr> found;
+                while (xmlNodePtr node = cursor.next())
+                {
+                    found.push_back(node);
+                }
+                EXPECT_EQ(found, expected.data()) << selector;
+                EXPECT_EQ(cursor.next(), nullptr);
+            }
+        }
+        freeNode(root);
+    }
+
+    TEST(MatchCursorTest, StreamIsLazy)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(cursorXml));
+
+        std::vector<std::string> texts;
+        for (Node node : doc.Stream("p"))
+        {
+            texts.push_back(node.Text().value_or(""));
+        }
+        EXPECT_EQ(texts, (std::vector<std::string>{"1", "2b", "4"}));
+
+        MatchRange range = doc.Stream(".x");
+        auto it = range.begin();
+        ASSERT_NE(it, range.end());
+        EXPECT_EQ((*it).Attribute("id"), "a");
+        ++it;
+        ++it;
+        ++it;
+        EXPECT_EQ(it, range.end());
+    }
+
+    TEST(MatchCursorTest, ForEachStopsEarly)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(cursorXml));
+
+        std::size_t visited = 0;
+        doc.ForEach("*", [&visited](Node)
+                    { return ++visited < 3; });
+        EXPECT_EQ(visited, 3);
+
+        std::vector<std::string> tags;
+        doc.Find("div, ul").ForEach(".x, span", [&tags](Node node)
+                                    {
+            tags.push_back(node.TagName().value_or(""));
+            return true; });
+        EXPECT_EQ(tags, (std::vector<std::string>{"div", "p", "div", "span"}));
+
+        visited = 0;
+        doc.Find("div, ul").ForEach("*", [&visited](Node)
+                                    { return ++visited < 2; });
+        EXPECT_EQ(visited, 2);
+    }
+
+    TEST(MatchCursorTest, ResumesOnAnotherThread)
+    {
+        xmlNodePtr root = createNode(cursorXml);
+        SelectorPtr parsed = SelectorParser::Create("body * p, li div span, ul ~ p");
+        SelectorPtr other = SelectorParser::Create("div p, body > *");
+        NodeSet expected = parsed->MatchAll(root);
+
+        // The cursor's results are its own: other walks, on this thread or
+        // the one resuming it, run in between.
+        MatchCursor cursor(*parsed, root);
+        std::vector<xmlNodePtr> found;
+        found.push_back(cursor.next());
+        EXPECT_EQ(other->MatchAll(root).size(), 5);
+        std::thread resume([&]()
+                           {
+            EXPECT_EQ(other->MatchAll(root).size(), 5);
+            found.push_back(cursor.next());
+            EXPECT_EQ(other->MatchAll(root).size(), 5); });
+        resume.join();
+        while (xmlNodePtr node = cursor.next())
+        {
+            found.push_back(node);
+        }
+        EXPECT_EQ(found, expected.data());
+        freeNode(root);
+    }
+}
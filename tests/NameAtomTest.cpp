@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    TEST(NameAtomTest, InternFoldsCase)
+    {
+        const NameAtom *div = NameAtom::Intern("div");
+
+        EXPECT_EQ(div, NameAtom::Intern("DIV"));
+        EXPECT_EQ(div, NameAtom::Intern("Div"));
+        EXPECT_NE(div, NameAtom::Intern("span"));
+        EXPECT_EQ(div->str(), "div");
+        EXPECT_EQ(div->tagKey(), AncestorFilter::TagKey("div"));
+    }
+
+    TEST(NameAtomTest, EqualsIgnoresCase)
+    {
+        const NameAtom *div = NameAtom::Intern("div");
+
+        EXPECT_TRUE(div->Equals(reinterpret_cast<const xmlChar *>("div")));
+        EXPECT_TRUE(div->Equals(reinterpret_cast<const xmlChar *>("DiV")));
+        EXPECT_FALSE(div->Equals(reinterpret_cast<const xmlChar *>("di")));
+        EXPECT_FALSE(div->Equals(reinterpret_cast<const xmlChar *>("divx")));
+        EXPECT_FALSE(div->Equals(nullptr));
+    }
+
+    TEST(NameAtomTest, UnstampedNodesCompareByName)
+    {
+        xmlNodePtr node = createNode("<DIV Class='a'><div/><span/></DIV>");
+
+        EXPECT_EQ(NameAtom::Of(node), nullptr);
+        EXPECT_TRUE(NameAtom::Intern("div")->Matches(node));
+        EXPECT_TRUE(NameAtom::Intern("class")->Matches(node->properties));
+        EXPECT_TRUE(NameAtom::SameName(node, node->children));
+        EXPECT_FALSE(NameAtom::SameName(node, node->children->next));
+        freeNode(node);
+    }
+
+    TEST(NameAtomTest, IndexedDocumentsAreStamped)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory("<div class='a'><DIV id='b'><span/></DIV></div>"));
+
+        xmlNodePtr outer = doc.Find("div.a").front();
+        xmlNodePtr inner = outer->children;
+
+        EXPECT_EQ(NameAtom::Of(outer), NameAtom::Intern("div"));
+        EXPECT_EQ(NameAtom::Of(inner), NameAtom::Intern("div"));
+        EXPECT_TRUE(NameAtom::Intern("id")->Matches(inner->properties));
+        EXPECT_TRUE(NameAtom::SameName(outer, inner));
+        EXPECT_FALSE(NameAtom::SameName(outer, inner->children));
+
+        EXPECT_EQ(doc.Find("div").size(), 2);
+        EXPECT_EQ(doc.Find("div:first-of-type").size(), 2);
+        EXPECT_EQ(doc.Find("[ID=b]").size(), 1);
+        EXPECT_TRUE(doc.Find("DIV").empty());
+    }
+
+    TEST(NameAtomTest, DocumentsDoNotInternNames)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory("<div><x-unseen-name>1</x-unseen-name><X-Unseen-Name>2</X-Unseen-Name><p/></div>"));
+
+        xmlNodePtr first = doc.getIndex()->GetElementsByTagName("x-unseen-name").front();
+        EXPECT_EQ(NameAtom::Find("x-unseen-name"), nullptr);
+        EXPECT_EQ(NameAtom::Of(first), nullptr);
+        EXPECT_EQ(NameAtom::Of(first->next), nullptr);
+        EXPECT_EQ(NameAtom::Find("P"), NameAtom::Of(first->next->next));
+        EXPECT_EQ(ElementInfo::Of(first->next)->typePosition, 2u);
+        EXPECT_EQ(ElementInfo::Of(first->next)->typeSiblings, 2u);
+
+        // A selector interning the name afterwards still matches by name.
+        EXPECT_EQ(doc.Find("x-unseen-name").size(), 2);
+        EXPECT_NE(NameAtom::Find("x-unseen-name"), nullptr);
+        EXPECT_EQ(doc.Find("x-unseen-name:last-of-type").size(), 1);
+        EXPECT_TRUE(NameAtom::SameName(first, first->next));
+    }
+}
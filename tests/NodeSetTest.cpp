@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    TEST(NodeSetTest, Insert_KeepsDocumentOrder)
+    {
+        xmlNodePtr node = createNode("<div><p>1</p><span>2</span><a>3</a></div>");
+        xmlNodePtr p = node->children;
+        xmlNodePtr span = p->next;
+        xmlNodePtr a = span->next;
+
+        NodeSet nodes;
+        nodes.insert(a);
+        nodes.insert(node);
+        nodes.insert(span);
+        nodes.insert(p);
+
+        ASSERT_EQ(nodes.size(), 4);
+        EXPECT_EQ(nodes[0], node);
+        EXPECT_EQ(nodes[1], p);
+        EXPECT_EQ(nodes[2], span);
+        EXPECT_EQ(nodes[3], a);
+        freeNode(node);
+    }
+
+    TEST(NodeSetTest, Insert_Duplicate)
+    {
+        xmlNodePtr node = createNode("<div><p>1</p></div>");
+
+        NodeSet nodes;
+        EXPECT_TRUE(nodes.insert(node->children).second);
+        EXPECT_TRUE(nodes.insert(node).second);
+        EXPECT_FALSE(nodes.insert(node->children).second);
+        EXPECT_EQ(nodes.size(), 2);
+        freeNode(node);
+    }
+
+    TEST(NodeSetTest, Merge_Interleaved)
+    {
+        xmlNodePtr node = createNode("<div><p>1</p><span><b>2</b></span><a>3</a></div>");
+        xmlNodePtr p = node->children;
+        xmlNodePtr span = p->next;
+        xmlNodePtr b = span->children;
+        xmlNodePtr a = span->next;
+
+        NodeSet left{p, b};
+        NodeSet right{span, b, a};
+        left.merge(right);
+
+        ASSERT_EQ(left.size(), 4);
+        EXPECT_EQ(left[0], p);
+        EXPECT_EQ(left[1], span);
+        EXPECT_EQ(left[2], b);
+        EXPECT_EQ(left[3], a);
+        freeNode(node);
+    }
+
+    TEST(NodeSetTest, Find_AndCount)
+    {
+        xmlNodePtr node = createNode("<div><p>1</p><span>2</span></div>");
+        NodeSet nodes{node, node->children};
+
+        EXPECT_NE(nodes.find(node->children), nodes.end());
+        EXPECT_EQ(nodes.find(node->children->next), nodes.end());
+        EXPECT_EQ(nodes.count(node), 1);
+        EXPECT_EQ(nodes.count(node->children->next), 0);
+        freeNode(node);
+    }
+}
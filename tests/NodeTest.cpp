@@ -172,4 +172,35 @@ namespace lxml2query
         Node invalidNode(nullptr);
         EXPECT_FALSE(invalidNode.valid());
     }
-}
\ No newline at end of file
+
+    TEST(NodeTest, Matches)
+    {
+        xmlNodePtr node = createNode("<div class='a'><p id='x'>Test</p></div>");
+        Node p(node->children);
+
+        EXPECT_TRUE(p.Matches("div > p#x"));
+        EXPECT_FALSE(p.Matches("span"));
+        EXPECT_TRUE(Node(node).Matches(".a"));
+        EXPECT_FALSE(Node(node->children->children).Matches("*")); // text
+        EXPECT_FALSE(Node(nullptr).Matches("*"));
+        freeNode(node);
+    }
+
+    TEST(NodeTest, Closest_TestsAncestorsOnly)
+    {
+        xmlNodePtr node = createNode("<section><div class='row'><span><b>x</b></span><div class='row'/></div></section>");
+        xmlNodePtr row = node->children;
+        xmlNodePtr span = row->children;
+        Node b(span->children);
+
+        auto closest = b.Closest(".row");
+        ASSERT_TRUE(closest.has_value());
+        EXPECT_EQ(closest.value()(), row);
+
+        // Matching descendants do not count.
+        EXPECT_FALSE(Node(node).Closest(".row").has_value());
+        EXPECT_EQ(b.Closest("b")->operator()(), span->children);
+        EXPECT_FALSE(b.Closest("ul").has_value());
+        freeNode(node);
+    }
+}
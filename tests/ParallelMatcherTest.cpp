@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+#include <atomic>
+#include <sstream>
+#include <thread>
+
+namespace lxml2query
+{
+    static std::string parallelHtml()
+    {
+        std::stringstream ss;
+        ss << "<html><body>";
+        for (int section = 0; section < 40; section++)
+        {
+            ss << "<section id='s" << section << "'" << (section % 3 == 0 ? " class='odd'" : "") << ">";
+            for (int depth = 0; depth < section % 7; depth++)
+            {
+                ss << "<div class='d" << depth << "'>";
+            }
+            for (int row = 0; row < 25; row++)
+            {
+                ss << "<p class='r" << row % 4 << "'><a href='#" << row << "'>x" << row << "</a><span>y</span></p>";
+            }
+            for (int depth = 0; depth < section % 7; depth++)
+            {
+                ss << "</div>";
+            }
+            ss << "</section>";
+        }
+        ss << "</body></html>";
+        return ss.str();
+    }
+
+    TEST(ParallelMatcherTest, AgreesWithSerialMatchAll)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(parallelHtml()));
+
+        const char *selectors[] = {"*", "p", "section.odd p > a", "div div p.r1", "p:nth-child(3n+1) span", "section:has(div.d4)", "a:contains('x1')", "p + p", "div ~ p", "body"};
+        for (const char *selector : selectors)
+        {
+            SelectorPtr parsed = SelectorParser::Create(selector);
+            NodeSet expected = parsed->MatchAll(doc.getRoot());
+
+            for (std::size_t threads : {2, 3, 8})
+            {
+                EXPECT_EQ(ParallelMatcher::MatchAll(*parsed, doc.getRoot(), threads), expected) << selector << " x" << threads;
+            }
+            EXPECT_EQ(ParallelMatcher::MatchAll(*parsed, doc.getRoot()->children, 4), parsed->MatchAll(doc.getRoot()->children)) << selector;
+        }
+    }
+
+    TEST(ParallelMatcherTest, ConcurrentQueriesShareThePool)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(parallelHtml()));
+
+        SelectorPtr parsed = SelectorParser::Create("section:has(div.d3) p:not(:has(a[href='#4'])) span");
+        NodeSet expected = parsed->MatchAll(doc.getRoot());
+        ASSERT_FALSE(expected.empty());
+
+        // Queries finding the workers busy run on their own thread.
+        std::vector<std::thread> callers;
+        std::atomic<int> mismatches{0};
+        for (int i = 0; i < 4; i++)
+        {
+            callers.emplace_back([&]()
+                                 {
+                for (int run = 0; run < 10; run++)
+                {
+                    if (ParallelMatcher::MatchAll(*parsed, doc.getRoot(), 4) != expected)
+                    {
+                        mismatches++;
+                    }
+                } });
+        }
+        for (std::thread &caller : callers)
+        {
+            caller.join();
+        }
+        EXPECT_EQ(mismatches.load(), 0);
+    }
+
+    TEST(ParallelMatcherTest, DocumentFindOption)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(parallelHtml()));
+
+        ParallelOptions options;
+        options.threads = 4;
+        options.threshold = 0;
+
+        EXPECT_EQ(doc.Find("section p > span", options).size(), doc.Find("section p > span").size());
+        EXPECT_EQ(doc.Find("#s7 a", options).size(), 25);
+        EXPECT_EQ(doc.Find("p.r2", options).size(), 40 * 6);
+
+        options.threshold = SIZE_MAX;
+        EXPECT_EQ(doc.Find("div p", options).size(), doc.Find("div p").size());
+    }
+}
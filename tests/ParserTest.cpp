@@ -295,6 +295,8 @@ namespace lxml2query
         EXPECT_THROW(Parse("div:nth-child(an+b)"), std::runtime_error);
         EXPECT_THROW(Parse("div:nth-child(an-b)"), std::runtime_error);
         EXPECT_THROW(Parse("div:nth-child(a+b)"), std::runtime_error);
+        EXPECT_THROW(Parse("div[attr#=/a(b/]"), std::runtime_error);
+        EXPECT_THROW(Parse("div:matches('[a')"), std::runtime_error);
     }
 
     TEST_F(SelectorParserTest, ParseRandomSelectors_Valid)
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    static std::string planHtml()
+    {
+        std::string html = "<html><body><div id='main'><ul><li class='item'>a</li><li class='item'>b</li><li class='item'>c</li></ul></div><section>";
+        for (int i = 0; i < 50; i++)
+        {
+            html += "<p class='item'>" + std::to_string(i) + "</p>";
+        }
+        return html + "</section></body></html>";
+    }
+
+    TEST(QueryPlanTest, SubtreeSizes)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(planHtml()));
+        const DocumentIndex *index = doc.getIndex();
+
+        EXPECT_EQ(index->SubtreeSize(doc.getRoot()), index->ElementCount());
+        EXPECT_EQ(index->SubtreeSize(doc.Find("#main")[0]->operator()()), 5u);
+        EXPECT_EQ(index->SubtreeSize(doc.Find("section")[0]->operator()()), 51u);
+        EXPECT_EQ(index->SubtreeSize(doc.Find("li")[0]->operator()()), 1u);
+    }
+
+    TEST(QueryPlanTest, ChoosesCheapestStrategy)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(planHtml()));
+        using Strategy = QueryPlan::Strategy;
+
+        QueryPlan plan = doc.Explain("#main");
+        EXPECT_EQ(plan.strategy, Strategy::IdSeed);
+        EXPECT_EQ(plan.cost, 1u);
+        EXPECT_EQ(plan.scanCost, doc.getIndex()->ElementCount());
+
+        plan = doc.Explain("li");
+        EXPECT_EQ(plan.strategy, Strategy::TagSeed);
+        EXPECT_EQ(plan.key, "li");
+        EXPECT_EQ(plan.cost, 3u);
+
+        plan = doc.Explain("p.item");
+        EXPECT_EQ(plan.strategy, Strategy::TagSeed);
+        EXPECT_EQ(plan.cost, 50u);
+
+        plan = doc.Explain(".item");
+        EXPECT_EQ(plan.strategy, Strategy::ClassSeed);
+        EXPECT_EQ(plan.cost, 53u);
+
+        // The anchor's subtree is far smaller than the class posting list.
+        plan = doc.Explain("#main .item");
+        EXPECT_EQ(plan.strategy, Strategy::ScopedDescent);
+        EXPECT_EQ(plan.key, "main");
+        EXPECT_EQ(plan.cost, 25u);
+        EXPECT_EQ(plan.scanCost, 5 * doc.getIndex()->ElementCount());
+
+        // Each compound is tested once, instead of walking the ancestors of
+        // every p.
+        plan = doc.Explain("section p");
+        EXPECT_EQ(plan.strategy, Strategy::StructuralJoin);
+        EXPECT_EQ(plan.cost, 51u);
+        plan = doc.Explain("ul > li ~ li");
+        EXPECT_EQ(plan.strategy, Strategy::StructuralJoin);
+        EXPECT_EQ(plan.cost, 7u);
+
+        plan = doc.Explain("*");
+        EXPECT_EQ(plan.strategy, Strategy::Scan);
+        plan = doc.Explain(":first-child");
+        EXPECT_EQ(plan.strategy, Strategy::Scan);
+    }
+
+    TEST(QueryPlanTest, UnionBranches)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(planHtml()));
+        using Strategy = QueryPlan::Strategy;
+
+        QueryPlan plan = doc.Explain("li, #main, section");
+        ASSERT_EQ(plan.strategy, Strategy::Union);
+        ASSERT_EQ(plan.branches.size(), 3u);
+        EXPECT_EQ(plan.cost, 5u);
+        for (const QueryPlan &branch : plan.branches)
+        {
+            EXPECT_NE(branch.strategy, Strategy::Scan);
+        }
+
+        // One branch needs a scan, so the whole group does.
+        plan = doc.Explain("li, :first-child");
+        EXPECT_EQ(plan.strategy, Strategy::Scan);
+        EXPECT_TRUE(plan.branches.empty());
+    }
+
+    TEST(QueryPlanTest, SubtreeScopes)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(planHtml()));
+        const DocumentIndex *index = doc.getIndex();
+        using Strategy = QueryPlan::Strategy;
+
+        xmlNodePtr body = doc.Find("body")[0]->operator()();
+        xmlNodePtr section = doc.Find("section")[0]->operator()();
+        xmlNodePtr main = doc.Find("#main")[0]->operator()();
+
+        // A posting list reaching outside the scope can cost more than a scan.
+        EXPECT_EQ(index->Plan(body, *SelectorParser::Create("li")).strategy, Strategy::TagSeed);
+        EXPECT_EQ(index->Plan(section, *SelectorParser::Create(".item")).strategy, Strategy::Scan);
+        // Inside the anchor, there is nothing left to narrow.
+        EXPECT_EQ(index->Plan(main, *SelectorParser::Create("#main .item")).strategy, Strategy::Scan);
+        EXPECT_EQ(index->Plan(body, *SelectorParser::Create("#main .item")).strategy, Strategy::ScopedDescent);
+    }
+
+    TEST(QueryPlanTest, PlansAgreeWithScan)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(planHtml()));
+
+        const char *selectors[] = {"#main", "li", "p.item", ".item", "#main .item", "*", ":first-child", "li, #main, section", "li, :first-child", "section > .item:last-child", "#missing", ".missing p", "section p", "ul > li ~ li", "li + li", "* html", ":not(p) body", "div li:nth-child(2)"};
+        for (const char *selector : selectors)
+        {
+            SelectorPtr parsed = SelectorParser::Create(selector);
+            EXPECT_EQ(doc.Find(selector).toVector().size(), parsed->MatchAll(doc.getRoot()).size()) << selector;
+
+            for (const char *scope : {"body", "section", "#main", "ul"})
+            {
+                xmlNodePtr node = doc.Find(scope)[0]->operator()();
+                NodeSet found;
+                if (!doc.getIndex()->Find(node, *parsed, found))
+                {
+                    found = parsed->MatchAll(node);
+                }
+                EXPECT_EQ(found, parsed->MatchAll(node)) << selector << " in " << scope;
+            }
+        }
+    }
+
+    TEST(QueryPlanTest, DescribesRejectedOptions)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(planHtml()));
+
+        std::string description = doc.Explain("#main .item").toString();
+        EXPECT_NE(description.find("scoped descent from id main: 25, scan 290"), std::string::npos) << description;
+        EXPECT_NE(description.find("rejected: scan"), std::string::npos) << description;
+        EXPECT_NE(description.find("seed class item 265"), std::string::npos) << description;
+
+        EXPECT_EQ(doc.Explain("li, #main").toString().find("union"), 0u);
+    }
+} // namespace lxml2query
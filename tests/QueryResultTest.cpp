@@ -137,6 +137,19 @@ namespace lxml2query
         ASSERT_EQ(found.size(), 2);
     }
 
+    TEST_F(QueryResultTest, Find_DocumentOrder)
+    {
+        QueryResult found = QueryResult::Find(root_, "p, span, div");
+        ASSERT_EQ(found.size(), 5);
+        EXPECT_EQ(GetNodeId(found[0].value()), "div1");
+        EXPECT_EQ(found[1].value().Attribute("class"), "p1");
+        EXPECT_EQ(found[2].value().Attribute("class"), "p2");
+        EXPECT_EQ(GetNodeId(found[3].value()), "div2");
+        EXPECT_EQ(found[4].value().Attribute("class"), "s1");
+        EXPECT_EQ(found.end() - found.begin(), 5);
+        EXPECT_EQ(found.begin()[4](), found.back()());
+    }
+
     TEST_F(QueryResultTest, At_ValidIndex)
     {
         QueryResult::NodeSet nodes;
@@ -179,4 +192,45 @@ namespace lxml2query
         //ASSERT_EQ(vec[0], div1);
         //ASSERT_EQ(vec[1], div2);
     }
-}
\ No newline at end of file
+
+    TEST_F(QueryResultTest, Closest_SharesAncestors)
+    {
+        QueryResult paragraphs = QueryResult::Find(root_, "p, span");
+        ASSERT_EQ(paragraphs.size(), 3);
+
+        QueryResult divs = paragraphs.Closest("div");
+        ASSERT_EQ(divs.size(), 2);
+        EXPECT_EQ(divs.front()(), GetElementById(root_, "div1"));
+        EXPECT_EQ(divs.back()(), GetElementById(root_, "div2"));
+
+        QueryResult self = paragraphs.Closest("p");
+        EXPECT_EQ(self.size(), 2);
+        EXPECT_TRUE(paragraphs.Closest("ul").empty());
+    }
+
+    TEST_F(QueryResultTest, Parents_ExcludesSelf)
+    {
+        QueryResult paragraphs = QueryResult::Find(root_, "p");
+
+        QueryResult parents = paragraphs.Parents("*");
+        ASSERT_EQ(parents.size(), 3);
+        EXPECT_EQ(parents[0]->TagName(), "html");
+        EXPECT_EQ(parents[1]->TagName(), "body");
+        EXPECT_EQ(parents[2]->TagName(), "div");
+
+        EXPECT_TRUE(paragraphs.Parents("p").empty());
+        EXPECT_EQ(QueryResult::Find(root_, "span").Parents("#div2").size(), 1);
+    }
+
+    TEST_F(QueryResultTest, Count_SkipsNestedNodes)
+    {
+        QueryResult scopes = QueryResult::Find(root_, "body, div, p");
+        ASSERT_EQ(scopes.size(), 5);
+
+        EXPECT_EQ(scopes.Count("p"), 2);
+        EXPECT_EQ(scopes.Find("p").size(), 2);
+        EXPECT_EQ(scopes.Find("*", 4).size(), 4);
+        EXPECT_EQ(scopes.FindFirst("span")->operator()(), GetElementById(root_, "div2")->children);
+        EXPECT_FALSE(scopes.Exists("ul"));
+    }
+}
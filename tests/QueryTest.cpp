@@ -57,6 +57,46 @@ namespace lxml2query
         EXPECT_TRUE(CompareVector(resStr, testCase.expectedMatches)) << ss.str();
     }
 
+    TEST_P(SelectorTest, CompiledMatchesInterpreted)
+    {
+        const TestCase &testCase = GetParam();
+
+        SelectorPtr selector = SelectorParser::Create(testCase.selector);
+        SelectorPtr compiled = SelectorParser::Create(testCase.selector, true);
+
+        ASSERT_NE(std::dynamic_pointer_cast<CompiledSelector>(compiled), nullptr);
+        EXPECT_EQ(compiled->toString(), selector->toString());
+
+        auto expected = doc_.Find(selector);
+        auto actual = doc_.Find(compiled);
+
+        ASSERT_EQ(actual.size(), expected.size()) << testCase.selector;
+        for (std::size_t i = 0; i < actual.size(); i++)
+        {
+            EXPECT_EQ(actual[i].value()(), expected[i].value()()) << testCase.selector;
+        }
+    }
+
+    TEST_P(SelectorTest, OptimizedMatchesInterpreted)
+    {
+        const TestCase &testCase = GetParam();
+
+        SelectorPtr selector = SelectorParser::Create(testCase.selector);
+        auto expected = doc_.Find(selector);
+
+        for (bool compile : {false, true})
+        {
+            SelectorPtr optimized = SelectorParser::Create(testCase.selector, compile, true);
+            auto actual = doc_.Find(optimized);
+
+            ASSERT_EQ(actual.size(), expected.size()) << testCase.selector << " -> " << optimized->toString();
+            for (std::size_t i = 0; i < actual.size(); i++)
+            {
+                EXPECT_EQ(actual[i].value()(), expected[i].value()()) << testCase.selector;
+            }
+        }
+    }
+
     INSTANTIATE_TEST_SUITE_P(
         SelectorTests,
         SelectorTest,
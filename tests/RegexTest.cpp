@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    TEST(RegexTest, RequiredLiteral)
+    {
+        EXPECT_EQ(Regex::RequiredLiteral("hello"), "hello");
+        EXPECT_EQ(Regex::RequiredLiteral("\\d+ items"), " items");
+        EXPECT_EQ(Regex::RequiredLiteral("^ab.cdef$"), "cdef");
+        EXPECT_EQ(Regex::RequiredLiteral("colou?r"), "colo");
+        EXPECT_EQ(Regex::RequiredLiteral("ab*cd"), "cd");
+        EXPECT_EQ(Regex::RequiredLiteral("abc{0,2}x"), "ab");
+        EXPECT_EQ(Regex::RequiredLiteral("abc{2}x"), "abc");
+        EXPECT_EQ(Regex::RequiredLiteral("a\\.b[cd]"), "a.b");
+        EXPECT_EQ(Regex::RequiredLiteral("x(abc)?yz"), "yz");
+        EXPECT_EQ(Regex::RequiredLiteral("foo|bar"), "");
+        EXPECT_EQ(Regex::RequiredLiteral("(foo|bar)baz"), "baz");
+        EXPECT_EQ(Regex::RequiredLiteral("\\w+"), "");
+    }
+
+    TEST(RegexTest, Search)
+    {
+        Regex regex("\\d+ items");
+
+        EXPECT_EQ(regex.getLiteral(), " items");
+        EXPECT_TRUE(regex.search("42 items"));
+        EXPECT_FALSE(regex.search("no items"));
+        EXPECT_FALSE(regex.search("42 things"));
+        EXPECT_TRUE(Regex("colou?r").search("color"));
+        EXPECT_TRUE(Regex("colou?r").search("colour"));
+    }
+
+    TEST(RegexTest, InvalidPatternThrows)
+    {
+        EXPECT_THROW(Regex("a(b"), std::regex_error);
+        EXPECT_THROW(Regex("a**"), std::regex_error);
+        EXPECT_THROW(Regex("[b-a]"), std::regex_error);
+        EXPECT_THROW(Regex("a{3,1}"), std::regex_error);
+    }
+
+    TEST(RegexTest, LinearEngine)
+    {
+        Regex regex("^(?:foo|ba[rz])\\b\\s*\\d{2,3}$");
+
+        EXPECT_TRUE(regex.isLinear());
+        EXPECT_TRUE(regex.search("baz 42"));
+        EXPECT_TRUE(regex.search("foo 123"));
+        EXPECT_FALSE(regex.search("foo123"));
+        EXPECT_FALSE(regex.search("food 42"));
+        EXPECT_FALSE(regex.search("bar 4"));
+        EXPECT_FALSE(regex.search("bar 4242"));
+        EXPECT_TRUE(Regex("").search(""));
+        EXPECT_TRUE(Regex("a.c").search("xabcx"));
+        EXPECT_FALSE(Regex("a.c").search("a\nc"));
+        EXPECT_TRUE(Regex("[^\\d\\s]").search("1 x"));
+        EXPECT_TRUE(Regex("\\x41\\.").search("A."));
+    }
+
+    TEST(RegexTest, PathologicalPatternsRunInLinearTime)
+    {
+        const std::string input(100000, 'a');
+
+        EXPECT_FALSE(Regex("(a*)*[bc]").search(input));
+        EXPECT_FALSE(Regex("(a|aa)+[bc]").search(input));
+        EXPECT_TRUE(Regex("(a|aa)+$").search(input));
+    }
+
+    TEST(RegexTest, DeepNestingThrows)
+    {
+        const std::size_t depth = 100000;
+        const std::string nested = std::string(depth, '(') + "a" + std::string(depth, ')');
+
+        EXPECT_THROW(Regex{nested}, std::regex_error);
+        // The std::regex fallback would recurse just as deep.
+        Regex::SetStdFallback(true);
+        EXPECT_THROW(Regex{nested}, std::regex_error);
+        Regex::SetStdFallback(false);
+
+        EXPECT_THROW(SelectorParser::Create("[attr#=/" + nested + "/]"), std::runtime_error);
+
+        const std::string shallow = std::string(200, '(') + "a" + std::string(200, ')');
+        EXPECT_TRUE(Regex(shallow).search("xay"));
+    }
+
+    TEST(RegexTest, LargeRepetitionsThrow)
+    {
+        EXPECT_THROW(Regex{"a{1001}"}, std::regex_error);
+        EXPECT_THROW(Regex{"a{2,1000000}"}, std::regex_error);
+        EXPECT_THROW(Regex{"(?:(?:){100000}){100000}"}, std::regex_error);
+        EXPECT_THROW(Regex{"((){1000000}){1000}"}, std::regex_error);
+        // Within the bounds, but compiling every copy of the empty bodies
+        // would take a billion steps.
+        EXPECT_THROW(Regex{"(?:(?:(?:){1000}){1000}){1000}"}, std::regex_error);
+        Regex::SetStdFallback(true);
+        EXPECT_THROW(Regex{"(?:(?:(?:){1000}){1000}){1000}"}, std::regex_error);
+        Regex::SetStdFallback(false);
+
+        EXPECT_THROW(SelectorParser::Create("[attr#=/((){1000000}){1000}/]"), std::runtime_error);
+
+        EXPECT_TRUE(Regex("^a{1000}$").search(std::string(1000, 'a')));
+        EXPECT_FALSE(Regex("^a{1000}$").search(std::string(999, 'a')));
+    }
+
+    TEST(RegexTest, UnsupportedPatterns)
+    {
+        EXPECT_THROW(Regex("(a)\\1"), std::regex_error);
+        EXPECT_THROW(Regex("a(?=b)"), std::regex_error);
+
+        Regex::SetStdFallback(true);
+        Regex backreference("(a)\\1");
+        Regex::SetStdFallback(false);
+
+        EXPECT_FALSE(backreference.isLinear());
+        EXPECT_TRUE(backreference.search("xaa"));
+        EXPECT_FALSE(backreference.search("xab"));
+    }
+}
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+#include <thread>
+
+namespace lxml2query
+{
+    TEST(SelectorCacheTest, RepeatedTextIsParsedOnce)
+    {
+        SelectorCache cache(4);
+
+        SelectorPtr first = cache.get("div > p");
+        SelectorPtr second = cache.get("div > p");
+
+        EXPECT_EQ(first, second);
+        EXPECT_EQ(first->toString(), SelectorParser::Create("div > p")->toString());
+
+        SelectorCache::Stats stats = cache.getStats();
+        EXPECT_EQ(stats.hits, 1);
+        EXPECT_EQ(stats.misses, 1);
+        EXPECT_EQ(stats.evictions, 0);
+        EXPECT_EQ(stats.size, 1);
+        EXPECT_EQ(stats.capacity, 4);
+    }
+
+    TEST(SelectorCacheTest, KeepsTreesAsWritten)
+    {
+        SelectorCache cache(4);
+        EXPECT_EQ(cache.get("p, p")->toString(), SelectorParser::Create("p, p")->toString());
+        EXPECT_EQ(std::dynamic_pointer_cast<NarySelector>(cache.get("a.b")), nullptr);
+    }
+
+    TEST(SelectorCacheTest, CompiledAndInterpretedAreSeparate)
+    {
+        SelectorCache cache(4);
+
+        SelectorPtr plain = cache.get("a[href]");
+        SelectorPtr compiled = cache.get("a[href]", true);
+
+        EXPECT_NE(plain, compiled);
+        EXPECT_NE(dynamic_cast<CompiledSelector *>(compiled.get()), nullptr);
+        EXPECT_EQ(dynamic_cast<CompiledSelector *>(plain.get()), nullptr);
+        EXPECT_EQ(cache.get("a[href]", true), compiled);
+    }
+
+    TEST(SelectorCacheTest, EvictsLeastRecentlyUsed)
+    {
+        SelectorCache cache(2);
+
+        SelectorPtr a = cache.get("a");
+        SelectorPtr b = cache.get("b");
+        cache.get("a");
+        cache.get("i");
+
+        EXPECT_EQ(cache.getStats().evictions, 1);
+        EXPECT_EQ(cache.get("a"), a);
+        EXPECT_NE(cache.get("b"), b);
+
+        cache.setCapacity(1);
+        EXPECT_EQ(cache.getStats().size, 1);
+        EXPECT_EQ(cache.getStats().evictions, 3);
+    }
+
+    TEST(SelectorCacheTest, ZeroCapacityDisablesCaching)
+    {
+        SelectorCache cache(0);
+
+        EXPECT_NE(cache.get("p"), cache.get("p"));
+        EXPECT_EQ(cache.getStats().size, 0);
+        EXPECT_EQ(cache.getStats().misses, 2);
+    }
+
+    TEST(SelectorCacheTest, InvalidSelectorsAreNotCached)
+    {
+        SelectorCache cache(4);
+
+        EXPECT_THROW(cache.get("div["), std::runtime_error);
+        EXPECT_THROW(cache.get("div["), std::runtime_error);
+        EXPECT_EQ(cache.getStats().size, 0);
+    }
+
+    TEST(SelectorCacheTest, WarmFillsTheCache)
+    {
+        SelectorCache cache(8);
+        cache.warm({"ul li", "#main", ".item:nth-child(2n)"});
+        cache.resetStats();
+
+        cache.get("ul li");
+        cache.get("#main");
+        cache.get(".item:nth-child(2n)");
+
+        SelectorCache::Stats stats = cache.getStats();
+        EXPECT_EQ(stats.hits, 3);
+        EXPECT_EQ(stats.misses, 0);
+        EXPECT_EQ(stats.size, 3);
+    }
+
+    TEST(SelectorCacheTest, ConcurrentLookups)
+    {
+        SelectorCache cache(4);
+        const char *selectors[] = {"p", "div p", "ul > li", "a[href]", "span.x", "#id"};
+
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&cache, &selectors]()
+                                 {
+                for (int i = 0; i < 1000; i++)
+                {
+                    const char *selector = selectors[i % 6];
+                    ASSERT_EQ(cache.get(selector)->toString(), SelectorParser::Create(selector)->toString());
+                } });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+
+        SelectorCache::Stats stats = cache.getStats();
+        EXPECT_EQ(stats.hits + stats.misses, 4000);
+        EXPECT_LE(stats.size, 4);
+    }
+
+    TEST(SelectorCacheTest, StringQueriesUseTheGlobalCache)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory("<div><p class='a'>x</p><p>y</p></div>"));
+
+        SelectorCache::Global().warm({"p.a", "div"});
+        SelectorCache::Stats before = SelectorCache::Global().getStats();
+
+        EXPECT_EQ(doc.Find("p.a").size(), 1);
+        EXPECT_EQ(doc.Find("div").Find("p.a").size(), 1);
+
+        SelectorCache::Stats after = SelectorCache::Global().getStats();
+        EXPECT_EQ(after.hits - before.hits, 3);
+        EXPECT_EQ(after.misses, before.misses);
+    }
+}
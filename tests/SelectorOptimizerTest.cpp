@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    static std::string optimized(std::string_view selector)
+    {
+        return SelectorParser::Create(selector, false, true)->toString();
+    }
+
+    TEST(SelectorOptimizerTest, FlattensAndOrdersByCost)
+    {
+        SelectorPtr selector = SelectorParser::Create("div:has(.x).foo[title]:first-child#main", false, true);
+        auto compound = std::dynamic_pointer_cast<NarySelector>(selector);
+        ASSERT_NE(compound, nullptr);
+        EXPECT_EQ(compound->getOperator(), NarySelector::Operator::Intersection);
+        EXPECT_EQ(compound->getSelectors().size(), 6);
+        EXPECT_EQ(selector->toString(), "div #main .foo [title] :first-child() :has(.x)");
+
+        EXPECT_EQ(optimized(":contains(a).b, p, [x]"), "p, [x], .b :contains(a)");
+        EXPECT_EQ(optimized("ul > li:not(:has(b)).a"), "ul > li .a :not(:has(b))");
+
+        SelectorPtr group = SelectorParser::Create("a, b, c, d", false, true);
+        auto list = std::dynamic_pointer_cast<NarySelector>(group);
+        ASSERT_NE(list, nullptr);
+        EXPECT_EQ(list->getOperator(), NarySelector::Operator::Union);
+        EXPECT_EQ(list->getSelectors().size(), 4);
+    }
+
+    TEST(SelectorOptimizerTest, RemovesDuplicates)
+    {
+        EXPECT_EQ(optimized("p.a.a"), "p .a");
+        EXPECT_EQ(optimized("a, b, a"), "a, b");
+        EXPECT_EQ(optimized("div .x.x > span"), "div .x > span");
+        EXPECT_EQ(optimized("#i, #i"), "#i");
+        EXPECT_EQ(optimized(":nth-child(2n+1), :nth-child(odd)"), ":nth-child(odd)");
+    }
+
+    TEST(SelectorOptimizerTest, KeepsBranchesPrintedAlike)
+    {
+        // Shorthands are case-sensitive, bracketed attributes are not, and
+        // both print the same.
+        xmlNodePtr node = createNode("<r><p id='foo'/><p id='FOO'/><p class='BAR'/></r>");
+        for (const char *selector : {"#foo, [id=FOO i]", ".bar, [class~=bar i]", ":not(#foo), :not([id=foo])"})
+        {
+            SelectorPtr plain = SelectorParser::Create(selector);
+            SelectorPtr group = SelectorParser::Create(selector, false, true);
+            auto list = std::dynamic_pointer_cast<NarySelector>(group);
+            ASSERT_NE(list, nullptr) << selector;
+            EXPECT_EQ(list->getSelectors().size(), 2) << selector;
+            EXPECT_EQ(group->MatchAll(node), plain->MatchAll(node)) << selector;
+        }
+        EXPECT_EQ(SelectorParser::Create("#foo, [id=FOO i]", false, true)->MatchAll(node).size(), 2);
+        EXPECT_EQ(SelectorParser::Create(".bar, [class~=bar i]", false, true)->MatchAll(node).size(), 1);
+        freeNode(node);
+
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory("<html><body><p id='foo'></p><p id='FOO'></p><p class='BAR'></p></body></html>"));
+        EXPECT_EQ(doc.Find("#foo, [id=FOO i]").size(), 2);
+        EXPECT_EQ(doc.Find(".bar, [class~=bar i]").size(), 1);
+    }
+
+    TEST(SelectorOptimizerTest, FoldsConstants)
+    {
+        EXPECT_EQ(optimized("*"), "*");
+        EXPECT_EQ(optimized("p, *"), "*");
+        EXPECT_EQ(optimized(":not(*)"), ":not(*)");
+        EXPECT_EQ(optimized("p:not(*)"), ":not(*)");
+        EXPECT_EQ(optimized(":not(:not(*))"), "*");
+        EXPECT_EQ(optimized("div > p:not(*)"), ":not(*)");
+        EXPECT_EQ(optimized("div:has(:not(*))"), ":not(*)");
+        EXPECT_EQ(optimized("p, :not(*)"), "p");
+        EXPECT_EQ(optimized("p:not(:not(*))"), "p");
+        EXPECT_EQ(optimized("DIV"), ":not(*)");
+    }
+
+    TEST(SelectorOptimizerTest, LongGroups)
+    {
+        std::string selector = "p";
+        for (int i = 0; i < 20000; i++)
+        {
+            selector += ", .c" + std::to_string(i);
+        }
+
+        SelectorPtr group = SelectorParser::Create(selector, false, true);
+        auto list = std::dynamic_pointer_cast<NarySelector>(group);
+        ASSERT_NE(list, nullptr);
+        EXPECT_EQ(list->getSelectors().size(), 20001);
+
+        xmlNodePtr node = createNode("<r><p/><q class='c19999'/><q class='x'/></r>");
+        EXPECT_EQ(group->MatchAll(node).size(), 2);
+        freeNode(node);
+    }
+
+    TEST(SelectorOptimizerTest, LeavesUnchangedTreesShared)
+    {
+        SelectorPtr selector = SelectorParser::Create("div > p");
+        EXPECT_EQ(SelectorOptimizer::Optimize(selector), selector);
+        EXPECT_EQ(SelectorOptimizer::CostOf(*SelectorParser::Create("p")), SelectorOptimizer::Tag);
+        EXPECT_EQ(SelectorOptimizer::CostOf(*SelectorParser::Create(":has(p)")), SelectorOptimizer::Content);
+    }
+}
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    static const char *setHtml =
+        "<html><body><div id='main' class='box wide'><p class='note'>1</p><p>2<b class='note'>b</b></p></div>"
+        "<ul class='list'><li class='item x'>a</li><li class='item item'>b</li></ul><p id='tail'>3</p></body></html>";
+
+    TEST(SelectorSetTest, AgreesWithSeparateQueries)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(setHtml));
+
+        const char *selectors[] = {"p", ".note", "#main > p", "div p .note", "li.item:last-child", "*", ".box.wide", "ul > .x", "p + ul", "#tail", "[class]", "body > *", ".missing", "P"};
+
+        SelectorSet set;
+        for (const char *selector : selectors)
+        {
+            set.add(selector);
+        }
+        ASSERT_EQ(set.size(), std::size(selectors));
+
+        std::vector<SelectorSet::Match> matches = set.matchAll(doc.getRoot());
+
+        for (SelectorSet::RuleId rule = 0; rule < set.size(); rule++)
+        {
+            std::vector<xmlNodePtr> found;
+            for (const SelectorSet::Match &match : matches)
+            {
+                if (match.rule == rule)
+                {
+                    found.push_back(match.node);
+                }
+            }
+            EXPECT_EQ(found, SelectorParser::Create(selectors[rule])->MatchAll(doc.getRoot()).data()) << selectors[rule];
+            EXPECT_EQ(set.getHits(rule), found.size()) << selectors[rule];
+        }
+
+        for (std::size_t i = 1; i < matches.size(); i++)
+        {
+            EXPECT_TRUE(matches[i - 1].node != matches[i].node || matches[i - 1].rule < matches[i].rule);
+        }
+
+        set.resetHits();
+        EXPECT_EQ(set.getHits(0), 0);
+    }
+
+    TEST(SelectorSetTest, GroupsReportOnce)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(setHtml));
+
+        SelectorSet set;
+        SelectorSet::RuleId group = set.add(".item, li, ul > li.x");
+        SelectorSet::RuleId single = set.add(SelectorParser::Create("#main"));
+        EXPECT_EQ(group, 0);
+        EXPECT_EQ(single, 1);
+
+        std::vector<SelectorSet::Match> matches = set.matchAll(doc.getRoot());
+        ASSERT_EQ(matches.size(), 3);
+        EXPECT_EQ(matches[0].rule, single);
+        EXPECT_EQ(matches[1].rule, group);
+        EXPECT_EQ(matches[2].rule, group);
+        EXPECT_EQ(set.getHits(group), 2);
+
+        std::vector<SelectorSet::RuleId> rules;
+        set.match(matches[1].node, rules);
+        EXPECT_EQ(rules, std::vector<SelectorSet::RuleId>{group});
+        EXPECT_EQ(set.getHits(group), 3);
+
+        EXPECT_THROW(set.add("p >"), std::exception);
+        EXPECT_EQ(set.size(), 2);
+    }
+
+    TEST(SelectorSetTest, CaseInsensitiveBranches)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory("<html><body><p id='foo'></p><p id='FOO'></p><p class='BAR'></p></body></html>"));
+
+        // The shorthand and the bracketed attribute print alike but only the
+        // bracketed one ignores case; neither branch may be dropped.
+        const char *selectors[] = {"#foo, [id=FOO i]", ".bar, [class~=bar i]"};
+        SelectorSet set;
+        for (const char *selector : selectors)
+        {
+            set.add(selector);
+        }
+
+        std::vector<SelectorSet::Match> matches = set.matchAll(doc.getRoot());
+        for (SelectorSet::RuleId rule = 0; rule < set.size(); rule++)
+        {
+            std::vector<xmlNodePtr> found;
+            for (const SelectorSet::Match &match : matches)
+            {
+                if (match.rule == rule)
+                {
+                    found.push_back(match.node);
+                }
+            }
+            EXPECT_EQ(found, SelectorParser::Create(selectors[rule])->MatchAll(doc.getRoot()).data()) << selectors[rule];
+        }
+        EXPECT_EQ(set.getHits(0), 2);
+        EXPECT_EQ(set.getHits(1), 1);
+    }
+
+    TEST(SelectorSetTest, ManyRules)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(setHtml));
+
+        SelectorSet set;
+        for (int i = 0; i < 5000; i++)
+        {
+            set.add(".rule" + std::to_string(i) + " > p");
+        }
+        SelectorSet::RuleId hit = set.add("div.box > p.note");
+
+        std::vector<SelectorSet::Match> matches = set.matchAll(doc.getRoot());
+        ASSERT_EQ(matches.size(), 1);
+        EXPECT_EQ(matches[0].rule, hit);
+    }
+}
@@ -128,6 +128,19 @@ namespace lxml2query
         freeNode(node);
     }
 
+    TEST(SelectorTest, MatchAll_DocumentOrder)
+    {
+        xmlNodePtr node = createNode("<div><span><b>1</b></span><p>2</p></div>");
+        MockSelector selector(true);
+        Selector::NodeSet result = selector.MatchAll(node);
+        ASSERT_EQ(result.size(), 4);
+        EXPECT_EQ(result[0], node);
+        EXPECT_EQ(result[1], node->children);
+        EXPECT_EQ(result[2], node->children->children);
+        EXPECT_EQ(result[3], node->children->next);
+        freeNode(node);
+    }
+
     TEST(SelectorTest, MatchAll_TextNodes)
     {
         xmlNodePtr node = createNode("<div>Text<span>Test1</span>Text2</div>");
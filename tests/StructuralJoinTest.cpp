@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+#include "TestsUtils.hpp"
+
+namespace lxml2query
+{
+    static const char *joinHtml =
+        "<html><body><div class='a'><p>1</p><div><p>2</p><b>x</b><p>3</p></div><p>4</p></div>"
+        "<section><p>5</p><i>y</i><p>6</p><div class='a'><b>z</b></div></section><p>7</p></body></html>";
+
+    // Evaluates a combinator chain the way DocumentIndex does, one compound
+    // at a time.
+    static std::vector<xmlNodePtr> joinAll(const DocumentIndex &index, const Selector &selector)
+    {
+        std::vector<StructuralJoin::Step> steps;
+        if (!StructuralJoin::Decompose(selector, steps))
+        {
+            return {};
+        }
+
+        auto select = [&](const Selector &compound)
+        {
+            StructuralJoin::ElementList selected;
+            for (xmlNodePtr element : index.GetElements())
+            {
+                if (compound.matches(element))
+                {
+                    selected.push_back(element);
+                }
+            }
+            return selected;
+        };
+
+        StructuralJoin::ElementList matched = select(*steps.front().compound);
+        for (std::size_t i = 1; i < steps.size(); i++)
+        {
+            matched = StructuralJoin::Join(index, matched, select(*steps[i].compound), steps[i].combinator, steps[i].adjacent);
+        }
+        return matched;
+    }
+
+    TEST(StructuralJoinTest, AgreesWithCombinators)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(joinHtml));
+        const DocumentIndex &index = *doc.getIndex();
+
+        const char *selectors[] = {"div p", "div > p", "p + p", "p ~ p", "div div p", ".a > b", "section p ~ p", "body > p", "p + b", "div ~ p", "section > .a b", "div p + b ~ p", "i ~ *", "body > * > p:first-child"};
+        for (const char *text : selectors)
+        {
+            SelectorPtr selector = SelectorParser::Create(text);
+            EXPECT_EQ(joinAll(index, *selector), selector->MatchAll(doc.getRoot()).data()) << text;
+
+            // The planner may or may not pick a join; Find agrees either way.
+            EXPECT_EQ(doc.Find(text).toVector().size(), selector->MatchAll(doc.getRoot()).size()) << text;
+        }
+    }
+
+    TEST(StructuralJoinTest, Decompose)
+    {
+        std::vector<StructuralJoin::Step> steps;
+
+        // Steps point into the selector.
+        SelectorPtr chain = SelectorParser::Create("ul.x > li a + b");
+        ASSERT_TRUE(StructuralJoin::Decompose(*chain, steps));
+        ASSERT_EQ(steps.size(), 4u);
+        EXPECT_EQ(steps[0].compound->toString(), SelectorParser::Create("ul.x")->toString());
+        EXPECT_EQ(steps[1].combinator, BinarySelector::Operator::Child);
+        EXPECT_EQ(steps[2].combinator, BinarySelector::Operator::Descendant);
+        EXPECT_EQ(steps[3].combinator, BinarySelector::Operator::Adjacent);
+        EXPECT_TRUE(steps[3].adjacent);
+
+        EXPECT_TRUE(StructuralJoin::Decompose(*SelectorParser::Create("a :has(b c)", true), steps));
+        EXPECT_FALSE(StructuralJoin::Decompose(*SelectorParser::Create("p.x"), steps));
+        EXPECT_FALSE(StructuralJoin::Decompose(*SelectorParser::Create("a b, c d"), steps));
+    }
+
+    // Checks the constant-time order and ancestry answers against walks of
+    // the tree, over every pair of elements.
+    static void expectTreeOrder(const std::vector<xmlNodePtr> &elements)
+    {
+        for (std::size_t i = 0; i < elements.size(); i++)
+        {
+            for (std::size_t j = 0; j < elements.size(); j++)
+            {
+                EXPECT_EQ(NodeSet::DocumentOrderLess(elements[i], elements[j]), i < j);
+
+                bool ancestor = false;
+                for (xmlNodePtr node = elements[j]; node != nullptr; node = node->parent)
+                {
+                    ancestor = ancestor || node == elements[i];
+                }
+                EXPECT_EQ(ElementInfo::IsInclusiveAncestor(elements[i], elements[j]), ancestor);
+            }
+        }
+    }
+
+    // Elements under root in document order, found by walking the tree.
+    static std::vector<xmlNodePtr> walkElements(xmlNodePtr root)
+    {
+        std::vector<xmlNodePtr> elements;
+        SelectorPtr all = SelectorParser::Create("*");
+        for (xmlNodePtr node : all->MatchAll(root))
+        {
+            elements.push_back(node);
+        }
+        return elements;
+    }
+
+    TEST(StructuralJoinTest, DocumentOrder)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(joinHtml));
+        const DocumentIndex &index = *doc.getIndex();
+        const StructuralJoin::ElementList &elements = index.GetElements();
+
+        ASSERT_EQ(elements.size(), index.ElementCount());
+        for (std::size_t i = 0; i < elements.size(); i++)
+        {
+            EXPECT_EQ(ElementInfo::Of(elements[i])->order, i);
+        }
+        expectTreeOrder(elements);
+    }
+
+    TEST(StructuralJoinTest, InsertedElementsAreOrderedByWalking)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(joinHtml));
+
+        // Insertions keep the indexed elements in the same relative order,
+        // and the new ones have no info to disagree with.
+        xmlNodePtr section = doc.Find("section").front();
+        xmlNodePtr added = xmlNewChild(section, nullptr, BAD_CAST "p", BAD_CAST "8");
+        xmlAddPrevSibling(section->children, xmlNewNode(nullptr, BAD_CAST "em"));
+        ASSERT_EQ(ElementInfo::Of(added), nullptr);
+
+        expectTreeOrder(walkElements(doc.getRoot()));
+    }
+
+    TEST(StructuralJoinTest, ReindexAfterMove)
+    {
+        Document doc;
+        ASSERT_TRUE(doc.parseMemory(joinHtml));
+
+        // Move the first div, with its subtree, to the end of the section.
+        xmlNodePtr moved = doc.Find("body > div.a").front();
+        xmlUnlinkNode(moved);
+        xmlAddChild(doc.Find("section").front(), moved);
+        doc.Reindex();
+
+        std::vector<xmlNodePtr> elements = walkElements(doc.getRoot());
+        EXPECT_EQ(doc.getIndex()->GetElements(), elements);
+        expectTreeOrder(elements);
+
+        const char *selectors[] = {"section p", "div > p", "p ~ p", "section > .a b", "div p + b ~ p"};
+        for (const char *text : selectors)
+        {
+            SelectorPtr selector = SelectorParser::Create(text);
+            EXPECT_EQ(joinAll(*doc.getIndex(), *selector), selector->MatchAll(doc.getRoot()).data()) << text;
+            EXPECT_EQ(doc.Find(text).toVector().size(), selector->MatchAll(doc.getRoot()).size()) << text;
+        }
+
+        // Nested roots are skipped by ancestry; the section now holds both divs.
+        EXPECT_EQ(doc.Find("section, .a").Find("b").size(), 2);
+    }
+} // namespace lxml2query
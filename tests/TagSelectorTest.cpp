@@ -147,4 +147,31 @@ namespace lxml2query
         ASSERT_NE(p1, nullptr);
         ASSERT_FALSE(selector.matches(p1));
     }
-} // namespace lxml2query
\ No newline at end of file
+
+    TEST(TagSelectorLangTest, TraversalAgreesWithStandalone)
+    {
+        xmlNodePtr node = createNode(
+            "<root lang='en-US'><div><p lang='fr'><span/><b lang='en'/></p><p/></div>"
+            "<section lang='de'><i/><p lang='english'/></section><aside lang=''><u/></aside></root>");
+
+        const char *selectors[] = {":lang(en)", ":lang(fr)", ":lang(de)", ":lang(en-US)", ":lang(english)", ":lang(es)", ":lang(fr) *", "p:lang(fr) > :lang(en)", ":not(:lang(de))", "div :lang(fr) ~ p"};
+        for (const char *text : selectors)
+        {
+            for (bool compile : {false, true})
+            {
+                SelectorPtr selector = SelectorParser::Create(text, compile);
+
+                // One element at a time, without a traversal.
+                Selector all;
+                NodeSet standalone = selector->Filter(all.MatchAll(node));
+
+                EXPECT_EQ(selector->MatchAll(node), standalone) << text;
+                EXPECT_EQ(selector->MatchAll(node->children), selector->Filter(all.MatchAll(node->children))) << text;
+            }
+        }
+        // Any ancestor with a matching lang counts, not only the nearest.
+        EXPECT_EQ(SelectorParser::Create(":lang(en)")->MatchAll(node).size(), 11);
+        EXPECT_EQ(SelectorParser::Create(":lang(de)")->MatchAll(node).size(), 3);
+        freeNode(node);
+    }
+} // namespace lxml2query
@@ -27,6 +27,22 @@ namespace lxml2query
         freeNode(node);
     }
 
+    TEST(TextSelectorTest, Contains_AcrossNodes)
+    {
+        xmlNodePtr node = createNode("<div>  Foo<b>Bar </b>\n\t<i>  baz</i><!--qux--> </div>");
+        EXPECT_TRUE(TextSelector(TextSelector::Operator::Contains, "foobar baz").matches(node));
+        EXPECT_TRUE(TextSelector(TextSelector::Operator::Contains, "r b").matches(node));
+        EXPECT_FALSE(TextSelector(TextSelector::Operator::Contains, "bar  baz").matches(node));
+        EXPECT_FALSE(TextSelector(TextSelector::Operator::Contains, " foo").matches(node));
+        EXPECT_FALSE(TextSelector(TextSelector::Operator::Contains, "baz ").matches(node));
+        EXPECT_FALSE(TextSelector(TextSelector::Operator::Contains, "qux").matches(node));
+        freeNode(node);
+
+        node = createNode("<p>a<b>aaa</b>b</p>");
+        EXPECT_TRUE(TextSelector(TextSelector::Operator::Contains, "aab").matches(node));
+        freeNode(node);
+    }
+
     TEST(TextSelectorTest, OwnContains_Match)
     {
         xmlNodePtr node = createNode("<div>Test <span>Nested</span> Content</div>");
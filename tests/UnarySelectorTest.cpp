@@ -128,4 +128,41 @@ namespace lxml2query
         EXPECT_FALSE(unarySelector.matches(textNode));
         freeNode(node);
     }
-}
\ No newline at end of file
+
+    TEST(UnarySelectorTest, HasDescendant_MatchAllAgreesWithMatches)
+    {
+        xmlNodePtr root = createNode("<r><div class='x'><div><p/><div><span/></div></div></div><div><b/><div><span/></div></div></r>");
+        xmlNodePtr inner = root->children->next->children->next; // second top-level div's inner div
+
+        for (const char *input : {"div:has(span)", "div:has(p) span", ":not(:has(b))", "div:has(div:has(span))", "div:has(b) > div"})
+        {
+            for (bool compile : {false, true})
+            {
+                SelectorPtr selector = SelectorParser::Create(input, compile);
+                for (xmlNodePtr scope : {root, inner})
+                {
+                    Selector::NodeSet expected;
+                    std::vector<xmlNodePtr> stack{scope};
+                    while (!stack.empty())
+                    {
+                        xmlNodePtr current = stack.back();
+                        stack.pop_back();
+                        if (selector->matches(current))
+                        {
+                            expected.insert(current);
+                        }
+                        for (xmlNodePtr child = current->children; child != nullptr; child = child->next)
+                        {
+                            if (child->type == XML_ELEMENT_NODE)
+                            {
+                                stack.push_back(child);
+                            }
+                        }
+                    }
+                    EXPECT_EQ(selector->MatchAll(scope), expected) << input << " compiled=" << compile;
+                }
+            }
+        }
+        freeNode(root);
+    }
+}